@@ -1,24 +1,71 @@
 #define REQUIRED_ARGS                                                                              \
     REQUIRED_STRING_ARG(                                                                           \
         operation, "operation",                                                                    \
-        "Operation to perform. Use <encode> to encode to qoi and <decode> to decode from qoi")     \
-    REQUIRED_STRING_ARG(inputFile, "input", "Input file path")                                     \
-    REQUIRED_STRING_ARG(outputFile, "output", "Output file path")
+        "Operation to perform. Use <encode> to encode to qoi and <decode> to decode from qoi. "    \
+        "Use <info> followed by one or more qoi files to print their headers. Use <batch> to "     \
+        "convert every file of a directory or manifest")                                           \
+    REQUIRED_STRING_ARG(inputFile, "input",                                                        \
+                        "Input file path. Use <-> to decode from standard input as it arrives. "   \
+                        "For <batch>, a directory or a manifest of input paths")                   \
+    REQUIRED_STRING_ARG(outputFile, "output", "Output file path. For <batch>, a directory")
 
 #define OPTIONAL_ARGS                                                                              \
     OPTIONAL_ARG(char const *, fileFormat, "ppm", "-f", "fileFormat",                              \
                  "Image format to encode from or decode to. Default is set to <ppm>, but "         \
                  "also supports <png>",                                                            \
+                 "%s", )                                                                           \
+    OPTIONAL_UINT_ARG(threads, 1, "-j", "threads",                                                 \
+                      "Number of threads to encode or decode with. Default is 1, 0 uses every "    \
+                      "hardware thread")                                                           \
+    OPTIONAL_UINT_ARG(workers, 0, "-w", "workers",                                                 \
+                      "Number of files <batch> converts at once. Default is 0, one per hardware "  \
+                      "thread")                                                                    \
+    OPTIONAL_UINT_ARG(readers, 2, "--readers", "readers",                                          \
+                      "Number of threads <batch> reads input files with. Default is 2")            \
+    OPTIONAL_UINT_ARG(writers, 2, "--writers", "writers",                                          \
+                      "Number of threads <batch> writes output files with. Default is 2")          \
+    OPTIONAL_UINT_ARG(maxMemory, 0, "--max-memory", "MB",                                          \
+                      "Megabytes the images <batch> converts at once may take together. Default "  \
+                      "is 0, no limit")                                                            \
+    OPTIONAL_ARG(char const *, io, "blocking", "--io", "io",                                       \
+                 "How <batch> reads and writes files: <blocking> calls, or <uring> to move many "  \
+                 "files at once through io_uring on Linux. Default is <blocking>",                 \
+                 "%s", )                                                                           \
+    OPTIONAL_ARG(char const *, state, "", "--state", "file",                                       \
+                 "State file of <batch>: jobs whose files have not changed since it recorded "     \
+                 "them are skipped, so a batch can be rerun or resumed. Default is none",          \
+                 "%s", )                                                                           \
+    OPTIONAL_ARG(char const *, isa, "auto", "--isa", "isa",                                        \
+                 "Instruction set the kernels use: <scalar>, <sse2>, <ssse3>, <avx2> or "          \
+                 "<avx512>. Default is <auto>, the best one the CPU supports",                     \
                  "%s", )
 
-#define BOOLEAN_ARGS BOOLEAN_ARG(help, "-h", "Show help")
+#define BOOLEAN_ARGS                                                                               \
+    BOOLEAN_ARG(dedup, "--dedup",                                                                  \
+                "Make <batch> hash its inputs first and convert each content once, linking the "   \
+                "outputs of inputs with the same content to the first one")                        \
+    BOOLEAN_ARG(help, "-h", "Show help")
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <optional>
 #include <stdexcept>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
+#include <qoi_batch.h>
+#include <qoi_batchstate.h>
 #include <qoi_constants.h>
+#include <qoi_cpu.h>
 #include <qoi_decoder.h>
 #include <qoi_encoder.h>
+#include <qoi_streamdecoder.h>
 #include <qoi_types.h>
 #include <qoi_utils.h>
 
@@ -26,7 +73,135 @@
 
 using namespace qoi;
 
+namespace {
+// Print the dimensions, channels, colorspace and, for a regular file, size of every QOI file in
+// 'paths', one line per file, reading nothing but the 14 byte headers. Return non-zero if any file
+// could not be read.
+auto printInfo(int numPaths, char *paths[]) -> int {
+    if (numPaths == 0) {
+        std::cerr << "Error occurred: <info> expects at least one QOI file\n";
+        return 1;
+    }
+
+    int status = 0;
+    for (int iter = 0; iter < numPaths; ++iter) {
+        const std::filesystem::path path = paths[iter];
+        try {
+            const QOIHeader header = readQOIHeader(path);
+
+            // a pipe has no size, so it is left out rather than printing half a line
+            std::error_code error;
+            const bool isRegular = std::filesystem::is_regular_file(path, error);
+            const std::uintmax_t size = isRegular ? std::filesystem::file_size(path) : 0;
+            std::cout << path.string() << ": width=" << header.d_width
+                      << ", height=" << header.d_height
+                      << ", channels=" << static_cast<unsigned int>(header.d_channels)
+                      << ", colorspace=" << static_cast<unsigned int>(header.d_colorspace);
+            if (isRegular) {
+                std::cout << ", size=" << size;
+            }
+
+            std::cout << '\n';
+        } catch (const std::exception &e) {
+            std::cerr << "Error occurred: " << path.string() << ": " << e.what() << '\n';
+            status = 1;
+        }
+    }
+
+    return status;
+}
+
+// Convert every file listed by 'input' into 'outputDir' with the threads given by 'options',
+// skipping the jobs the state file 'stateFile' finds up to date unless it is empty, then print any
+// failures and the throughput. Return non-zero if any file failed.
+auto runBatchCommand(const std::filesystem::path &input, const std::filesystem::path &outputDir,
+                     std::string_view fileFormat, const std::filesystem::path &stateFile,
+                     BatchOptions options) -> int {
+    const auto jobs = listBatchJobs(input, outputDir, fileFormat);
+
+    std::optional<BatchState> state;
+    if (!stateFile.empty()) {
+        options.d_state = &state.emplace(stateFile);
+    }
+
+    const BatchReport report = runBatch(jobs, options);
+
+    for (const auto &failure : report.d_failures) {
+        std::cerr << "Error occurred: " << failure.d_input.string() << ": " << failure.d_message
+                  << '\n';
+    }
+
+    const double seconds = std::max(report.d_seconds, 1e-9);
+    const double inputMB = static_cast<double>(report.d_inputBytes) / 1e6;
+    const double outputMB = static_cast<double>(report.d_outputBytes) / 1e6;
+    const double megapixels = static_cast<double>(report.d_numPixels) / 1e6;
+    std::cout << std::fixed << std::setprecision(2) << "converted " << report.d_numConverted
+              << " files (" << report.d_failures.size() << " failed) in " << report.d_seconds
+              << " s: " << inputMB << " MB in, " << outputMB << " MB out, " << megapixels
+              << " Mpixels, skipped " << report.d_numSkipped << " unchanged, "
+              << report.d_numDeduplicated << " deduplicated\n"
+              << "throughput: " << report.d_numConverted / seconds << " files/s, "
+              << inputMB / seconds << " MB/s, " << megapixels / seconds << " Mpixels/s\n";
+
+    return report.d_failures.empty() ? 0 : 1;
+}
+
+// Decode the QOI file arriving on standard input into 'outputFile' while it is still being read.
+// PPM rows are written out as soon as they are decoded; a PNG is written once the image is
+// complete.
+auto decodeStandardInput(const std::filesystem::path &outputFile, std::string_view fileFormat)
+    -> void {
+    const bool toPPM = fileFormat == PPM_FILE_FORMAT;
+    if (!toPPM && fileFormat != PNG_FILE_FORMAT) {
+        throw std::runtime_error("Invalid file format selected. Supported file format "
+                                 "include: <ppm> and <png>.");
+    }
+
+    std::ofstream ppm;
+    std::vector<Byte> png;
+    StreamDecoder decoder(
+        [&](std::span<const Byte> row, Height y) {
+            const QOIHeader &header = decoder.header();
+            if (!toPPM) {
+                png.insert(png.end(), row.begin(), row.end());
+                return;
+            }
+
+            if (y == 0) {
+                ppm.open(outputFile, std::ios::binary);
+                ppm << "P6\n" << header.d_width << " " << header.d_height << "\n255\n";
+            }
+
+            ppm.write(reinterpret_cast<const char *>(row.data()), row.size());
+        },
+        toPPM ? 3 : 0);
+
+    std::array<char, 1 << 16> chunk;
+    while (std::cin.read(chunk.data(), chunk.size()) || std::cin.gcount() > 0) {
+        decoder.push({reinterpret_cast<const Byte *>(chunk.data()),
+                      static_cast<std::size_t>(std::cin.gcount())});
+    }
+
+    decoder.finish();
+
+    const QOIHeader &header = decoder.header();
+    if (!toPPM) {
+        writeToPNGFile(outputFile, makeFileOutput(header.d_width, header.d_height,
+                                                  decoder.channels(), header.d_colorspace,
+                                                  std::move(png)));
+    } else if (header.d_width == 0 || header.d_height == 0) {
+        writeToPPMFile(outputFile, makeFileOutput(header.d_width, header.d_height, 3,
+                                                  header.d_colorspace, {}));
+    }
+}
+} // namespace
+
 int main(int argc, char *argv[]) {
+    // <info> takes any number of paths, so it is handled before the fixed argument parser
+    if (argc > 1 && argv[1] == INFO_OP) {
+        return printInfo(argc - 2, argv + 2);
+    }
+
     args_t args = make_default_args();
 
     if (!parse_args(argc, argv, &args) || args.help) {
@@ -35,29 +210,51 @@ int main(int argc, char *argv[]) {
     }
 
     try {
-        if (args.operation == DECODE_OP) {
+        // leave the level picked at startup, which honours QOI_ISA, unless asked for another one
+        if (std::string_view(args.isa) != "auto") {
+            setIsaLevel(parseIsaLevel(args.isa));
+        } else if (!rejectedIsaOverride().empty()) {
+            std::cerr << rejectedIsaOverride() << '\n';
+        }
+
+        if (args.operation == BATCH_OP) {
+            return runBatchCommand(args.inputFile, args.outputFile, args.fileFormat, args.state,
+                                   {.d_numReaders = args.readers,
+                                    .d_numWorkers = args.workers,
+                                    .d_numWriters = args.writers,
+                                    .d_maxMemory = std::uint64_t{args.maxMemory} * 1000000,
+                                    .d_ioBackend = parseIoBackend(args.io),
+                                    .d_deduplicate = args.dedup,
+                                    .d_state = nullptr});
+        } else if (args.operation == DECODE_OP && std::string_view(args.inputFile) == "-") {
+            decodeStandardInput(args.outputFile, args.fileFormat);
+        } else if (args.operation == DECODE_OP) {
             auto decoder = Decoder(0);
             if (args.fileFormat == PPM_FILE_FORMAT) {
                 const FileOutput output = readQOIFile(args.inputFile);
-                const DecodedOutput outBuffer = decoder.decodeQOI(output);
+                const FileOutput outBuffer = decoder.decodeQOIToBytes(output, 3, args.threads);
                 writeToPPMFile(args.outputFile, outBuffer);
             } else if (args.fileFormat == PNG_FILE_FORMAT) {
                 const FileOutput output = readQOIFile(args.inputFile);
-                const DecodedOutput outBuffer = decoder.decodeQOI(output);
+                const FileOutput outBuffer =
+                    decoder.decodeQOIToBytes(output, output.d_channels, args.threads);
                 writeToPNGFile(args.outputFile, outBuffer);
             } else {
                 throw std::runtime_error("Invalid file format selected. Supported file format "
                                          "include: <ppm> and <png>.");
             }
         } else if (args.operation == ENCODE_OP) {
-            auto encoder = Encoder();
+            // a temporary encoder hands over its buffer instead of copying it
             if (args.fileFormat == PPM_FILE_FORMAT) {
                 const FileOutput ppmData = readPPMFile(args.inputFile);
-                const EncodedOutput encodedBytes = encoder.encodeToQOI(ppmData);
+                const EncodedOutput encodedBytes = Encoder().encodeToQOI(ppmData, args.threads);
                 writeToQOIFile(args.outputFile, encodedBytes);
             } else if (args.fileFormat == PNG_FILE_FORMAT) {
                 const FileOutput pngData = readPNGFile(args.inputFile);
-                const EncodedOutput encodedBytes = encoder.encodeToQOI(pngData);
+                std::cout << "width=" << pngData.d_width << ", height=" << pngData.d_height
+                          << ", channels=" << static_cast<unsigned int>(pngData.d_channels)
+                          << std::endl;
+                const EncodedOutput encodedBytes = Encoder().encodeToQOI(pngData, args.threads);
                 writeToQOIFile(args.outputFile, encodedBytes);
             } else {
                 throw std::runtime_error("Invalid file format selected. Supported file format "
@@ -0,0 +1,862 @@
+#include <qoi_batch.h>
+
+#include <qoi_batchstate.h>
+#include <qoi_boundedqueue.h>
+#include <qoi_codecpool.h>
+#include <qoi_constants.h>
+#include <qoi_decoder.h>
+#include <qoi_hash.h>
+#include <qoi_ioring.h>
+#include <qoi_mappedfile.h>
+#include <qoi_memorybudget.h>
+#include <qoi_scheduler.h>
+#include <qoi_utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <spanstream>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
+#include <utility>
+
+namespace qoi {
+namespace {
+// Number of files a reader or writer of the io_uring backend moves per submission.
+constexpr std::size_t IO_BATCH_SIZE = 32;
+
+// Return the extension of 'path' in lower case and without the dot, e.g. "png".
+auto formatOf(const std::filesystem::path &path) -> std::string {
+    std::string format = path.extension().string();
+    if (!format.empty()) {
+        format.erase(0, 1);
+    }
+
+    std::transform(format.begin(), format.end(), format.begin(),
+                   [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+    return format;
+}
+
+auto isImageFile(const std::filesystem::path &path) -> bool {
+    const std::string format = formatOf(path);
+    return format == "qoi" || format == PPM_FILE_FORMAT || format == PNG_FILE_FORMAT;
+}
+
+// Return where 'input' is converted to inside 'outputDir' when no output is given for it.
+auto defaultOutput(const std::filesystem::path &input, const std::filesystem::path &outputDir,
+                   std::string_view decodeFormat) -> std::filesystem::path {
+    std::filesystem::path output = outputDir / input.stem();
+    output += formatOf(input) == "qoi" ? std::string(".") + std::string(decodeFormat) : ".qoi";
+    return output;
+}
+
+// Throw unless 'job' converts a QOI file to PPM or PNG, or a PPM or PNG file to QOI.
+auto checkJobFormats(const BatchJob &job) -> void {
+    const std::string inputFormat = formatOf(job.d_input);
+    if (inputFormat == "qoi") {
+        const std::string outputFormat = formatOf(job.d_output);
+        if (outputFormat != PPM_FILE_FORMAT && outputFormat != PNG_FILE_FORMAT) {
+            throw std::runtime_error("Cannot decode to " + job.d_output.string() +
+                                     ", expect a .ppm or .png output");
+        }
+    } else if (inputFormat != PPM_FILE_FORMAT && inputFormat != PNG_FILE_FORMAT) {
+        throw std::runtime_error("Cannot convert " + job.d_input.string() +
+                                 ", expect a .qoi, .ppm or .png input");
+    }
+}
+
+// Return the bytes of the output file of 'job' for 'output', as returned by 'convertJobInput',
+// keeping in 'scratch' whatever has to be built for it: the PPM header or the whole PNG.
+auto prepareWrite(const BatchJob &job, const FileOutput &output, std::vector<Byte> &scratch)
+    -> FileWrite {
+    scratch.clear();
+    if (formatOf(job.d_input) != "qoi") {
+        return {.d_path = job.d_output, .d_pieces = {output.d_bytes}};
+    }
+
+    if (formatOf(job.d_output) == PPM_FILE_FORMAT) {
+        const std::string header = "P6\n" + std::to_string(output.d_width) + " " +
+                                   std::to_string(output.d_height) + "\n255\n";
+        scratch.assign(header.begin(), header.end());
+        return {.d_path = job.d_output, .d_pieces = {scratch, output.d_bytes}};
+    }
+
+    const auto append = [](void *context, void *data, int size) {
+        auto *bytes = static_cast<Byte *>(data);
+        static_cast<std::vector<Byte> *>(context)->insert(
+            static_cast<std::vector<Byte> *>(context)->end(), bytes, bytes + size);
+    };
+
+    if (stbi_write_png_to_func(append, &scratch, output.d_width, output.d_height,
+                               output.d_channels, output.d_bytes.data(),
+                               output.d_width * output.d_channels) == 0) {
+        throw std::runtime_error("Failed to write file: " + job.d_output.string());
+    }
+
+    return {.d_path = job.d_output, .d_pieces = {scratch}};
+}
+
+// Create or replace the file of 'write' with its pieces, one blocking call after the other.
+auto writeFile(const FileWrite &write) -> void {
+    std::ofstream out(write.d_path, std::ios::binary);
+    for (const auto &piece : write.d_pieces) {
+        if (!out.write(reinterpret_cast<const char *>(piece.data()), piece.size())) {
+            throw std::runtime_error("Failed to write file: " + write.d_path.string());
+        }
+    }
+
+    if (!out.flush()) {
+        throw std::runtime_error("Failed to write file: " + write.d_path.string());
+    }
+}
+
+// Return the stamp of the file just written from 'write', hashing the bytes that were written
+// rather than reading the file back.
+auto stampWrite(const FileWrite &write) -> FileStamp {
+    ContentHasher hasher;
+    std::uintmax_t size = 0;
+    for (const auto &piece : write.d_pieces) {
+        hasher.update(piece);
+        size += piece.size();
+    }
+
+    return {.d_size = size, .d_modified = fileTime(write.d_path), .d_hash = hasher.digest()};
+}
+
+// Remove the output file 'output' before it is written if it is a hard link made for a duplicate,
+// since writing through the link would change every file linked to it as well.
+auto detachOutput(const std::filesystem::path &output) -> void {
+    std::error_code error;
+    if (std::filesystem::hard_link_count(output, error) > 1 && !error) {
+        std::filesystem::remove(output);
+    }
+}
+
+// Make 'output' a hard link to the file 'source', or a copy of it where the file system cannot
+// link, e.g. across devices.
+auto linkOutput(const std::filesystem::path &source, const std::filesystem::path &output) -> void {
+    std::filesystem::remove(output);
+
+    std::error_code error;
+    std::filesystem::create_hard_link(source, output, error);
+    if (error) {
+        std::filesystem::copy_file(source, output);
+    }
+}
+
+// A job whose input has the same content as that of another job, and the stamp of its input.
+struct DuplicateJob {
+    BatchJob d_job;
+    FileStamp d_inputStamp;
+};
+
+// Remove from 'jobs' every job whose input has the same content and format as an earlier job's
+// and whose output has the same format, so the same output, and return them by the index of that
+// earlier job in what is left of 'jobs'. The inputs are hashed on 'numThreads' threads, and the
+// stamps taken on the way are kept in 'inputStamps' by the index of each job left; a job whose
+// input cannot be read has no stamp and is left in 'jobs' for its conversion to report.
+auto removeDuplicateJobs(std::vector<BatchJob> &jobs,
+                         std::vector<std::optional<FileStamp>> &inputStamps,
+                         unsigned int numThreads) -> std::vector<std::vector<DuplicateJob>> {
+    std::vector<std::optional<FileStamp>> stamps(jobs.size());
+    {
+        std::atomic<std::size_t> next = 0;
+        std::vector<std::jthread> threads;
+        for (unsigned int thread = 0; thread < numThreads; ++thread) {
+            threads.emplace_back([&] {
+                for (std::size_t job = next++; job < jobs.size(); job = next++) {
+                    try {
+                        // the time is taken first, so a change made later shows up as one
+                        const std::int64_t modified = fileTime(jobs[job].d_input);
+                        const MappedFile file(jobs[job].d_input);
+                        stamps[job] = FileStamp{.d_size = file.bytes().size(),
+                                                .d_modified = modified,
+                                                .d_hash = hashContent(file.bytes())};
+                    } catch (const std::exception &) {
+                    }
+                }
+            });
+        }
+    }
+
+    using Key = std::tuple<std::uint64_t, std::uintmax_t, std::string, std::string>;
+    std::map<Key, std::size_t> firstJobs;
+    std::vector<BatchJob> uniqueJobs;
+    std::vector<std::vector<DuplicateJob>> duplicates;
+    inputStamps.clear();
+    for (std::size_t job = 0; job < jobs.size(); ++job) {
+        if (stamps[job]) {
+            const auto [first, isNew] = firstJobs.emplace(
+                Key{stamps[job]->d_hash, stamps[job]->d_size, formatOf(jobs[job].d_input),
+                    formatOf(jobs[job].d_output)},
+                uniqueJobs.size());
+            if (!isNew) {
+                duplicates[first->second].push_back(
+                    {.d_job = std::move(jobs[job]), .d_inputStamp = *stamps[job]});
+                continue;
+            }
+        }
+
+        uniqueJobs.push_back(std::move(jobs[job]));
+        inputStamps.push_back(stamps[job]);
+        duplicates.emplace_back();
+    }
+
+    jobs = std::move(uniqueJobs);
+    return duplicates;
+}
+} // namespace
+
+auto readJobInput(const BatchJob &job) -> FileOutput {
+    checkJobFormats(job);
+
+    const std::string inputFormat = formatOf(job.d_input);
+    if (inputFormat == "qoi") {
+        return readQOIFile(job.d_input, true);
+    }
+
+    return inputFormat == PPM_FILE_FORMAT ? readPPMFile(job.d_input) : readPNGFile(job.d_input);
+}
+
+auto parseJobInput(const BatchJob &job, std::vector<Byte> file) -> FileOutput {
+    auto storage = std::make_shared<const std::vector<Byte>>(std::move(file));
+    const std::span<const Byte> bytes{*storage};
+    return parseJobInput(job, bytes, std::move(storage));
+}
+
+auto parseJobInput(const BatchJob &job, std::span<const Byte> bytes,
+                   std::shared_ptr<const void> storage) -> FileOutput {
+    checkJobFormats(job);
+
+    const std::string inputFormat = formatOf(job.d_input);
+    if (inputFormat == "qoi") {
+        if (bytes.size() > MAX_FILE_SIZE) {
+            throw std::runtime_error(job.d_input.string() + " exceeds the limit of 1GB");
+        }
+
+        return parseQOIFile(bytes, std::move(storage));
+    }
+
+    if (inputFormat == PPM_FILE_FORMAT) {
+        std::ispanstream stream(
+            std::span<const char>(reinterpret_cast<const char *>(bytes.data()), bytes.size()));
+        Width width = 0;
+        Height height = 0;
+        readPPMHeader(stream, width, height);
+
+        const auto offset = static_cast<std::size_t>(stream.tellg());
+        const auto size = static_cast<std::size_t>(width) * height * 3;
+        if (!stream || bytes.size() - offset < size) {
+            throw std::runtime_error("Unable to read pixel data from PPM file");
+        }
+
+        return {.d_width = width,
+                .d_height = height,
+                .d_channels = 3,
+                .d_colorspace = 0,
+                .d_bytes = bytes.subspan(offset, size),
+                .d_storage = std::move(storage)};
+    }
+
+    int width;
+    int height;
+    int channels;
+    unsigned char *data = stbi_load_from_memory(bytes.data(), static_cast<int>(bytes.size()),
+                                                &width, &height, &channels, 0);
+    if (!data) {
+        throw std::runtime_error("Failed to load file: " + job.d_input.string());
+    }
+
+    std::vector<Byte> pixels(data, data + static_cast<std::size_t>(width) *
+                                               static_cast<std::size_t>(height) *
+                                               static_cast<std::size_t>(channels));
+    stbi_image_free(data);
+
+    return makeFileOutput(static_cast<Width>(width), static_cast<Height>(height),
+                          static_cast<Channel>(channels), 0, std::move(pixels));
+}
+
+auto convertJobInput(const BatchJob &job, const FileOutput &input, std::vector<Byte> &buffer)
+    -> FileOutput {
+    if (formatOf(job.d_input) == "qoi") {
+        const Channel channels =
+            formatOf(job.d_output) == PPM_FILE_FORMAT ? Channel{3} : input.d_channels;
+        // the header is checked against the size of the stream before anything is allocated
+        buffer.resize(pixelCount(input) * channels);
+        threadDecoder().decodeQOIToBytes(input, channels, buffer);
+        return {.d_width = input.d_width,
+                .d_height = input.d_height,
+                .d_channels = channels,
+                .d_colorspace = input.d_colorspace,
+                .d_bytes = buffer,
+                .d_storage = nullptr};
+    }
+
+    buffer.resize(maxEncodedSize(input.d_width, input.d_height, input.d_channels));
+    const std::size_t size = threadEncoder().encodeToQOI(input, buffer);
+    return {.d_width = input.d_width,
+            .d_height = input.d_height,
+            .d_channels = input.d_channels,
+            .d_colorspace = input.d_colorspace,
+            .d_bytes = std::span<const Byte>(buffer).first(size),
+            .d_storage = nullptr};
+}
+
+auto writeJobOutput(const BatchJob &job, const FileOutput &output) -> void {
+    std::vector<Byte> scratch;
+    writeFile(prepareWrite(job, output, scratch));
+}
+
+auto convertFile(const BatchJob &job) -> std::uint64_t {
+    // the buffer keeps its capacity, so a thread stops allocating once it saw its largest image
+    thread_local std::vector<Byte> buffer;
+
+    const FileOutput input = readJobInput(job);
+    writeJobOutput(job, convertJobInput(job, input, buffer));
+    return static_cast<std::uint64_t>(input.d_width) * input.d_height;
+}
+
+auto estimateJob(const BatchJob &job) -> JobEstimate {
+    const std::string format = formatOf(job.d_input);
+    try {
+        Width width = 0;
+        Height height = 0;
+        Channel channels = 0;
+        if (format == "qoi") {
+            const QOIHeader header = readQOIHeader(job.d_input);
+            width = header.d_width;
+            height = header.d_height;
+            channels = header.d_channels;
+        } else if (format == PPM_FILE_FORMAT) {
+            std::ifstream file{job.d_input, std::ios::binary};
+            readPPMHeader(file, width, height);
+            channels = file ? 3 : 0;
+        } else if (int pngWidth, pngHeight, pngChannels;
+                   format == PNG_FILE_FORMAT &&
+                   stbi_info(job.d_input.c_str(), &pngWidth, &pngHeight, &pngChannels) != 0) {
+            width = static_cast<Width>(pngWidth);
+            height = static_cast<Height>(pngHeight);
+            channels = static_cast<Channel>(pngChannels);
+        }
+
+        const std::uint64_t numPixels = static_cast<std::uint64_t>(width) * height;
+        if (channels == 0 || numPixels == 0) {
+            return {.d_numPixels = 0, .d_peakMemory = 0};
+        }
+
+        if (format != "qoi") {
+            // the pixels read, next to the largest QOI file they can encode to; for a PNG the
+            // stb buffer and the copy of it together take no more than that
+            return {.d_numPixels = numPixels,
+                    .d_peakMemory = numPixels * channels + maxEncodedSize(width, height, channels)};
+        }
+
+        // the preloaded file and the decoded pixels, plus the filtered rows and the compressed
+        // stream stb builds to write a PNG
+        const bool toPPM = formatOf(job.d_output) == PPM_FILE_FORMAT;
+        const std::uint64_t pixelBytes = numPixels * (toPPM ? 3 : channels);
+        return {.d_numPixels = numPixels,
+                .d_peakMemory = std::filesystem::file_size(job.d_input) + pixelBytes +
+                                (toPPM ? 0 : 2 * pixelBytes)};
+    } catch (const std::exception &) {
+        // the conversion itself reports what is wrong with the file
+    }
+
+    return {.d_numPixels = 0, .d_peakMemory = 0};
+}
+
+auto listBatchJobs(const std::filesystem::path &input, const std::filesystem::path &outputDir,
+                   std::string_view decodeFormat) -> std::vector<BatchJob> {
+    if (decodeFormat != PPM_FILE_FORMAT && decodeFormat != PNG_FILE_FORMAT) {
+        throw std::runtime_error("Invalid file format selected. Supported file format "
+                                 "include: <ppm> and <png>.");
+    }
+
+    std::vector<BatchJob> jobs;
+    std::vector<bool> isDefaultOutput;
+    if (std::filesystem::is_directory(input)) {
+        for (const auto &entry : std::filesystem::directory_iterator(input)) {
+            if (entry.is_regular_file() && isImageFile(entry.path())) {
+                jobs.push_back({.d_input = entry.path(),
+                                .d_output = defaultOutput(entry.path(), outputDir, decodeFormat)});
+            }
+        }
+
+        isDefaultOutput.assign(jobs.size(), true);
+
+        // directory order is arbitrary, sorting keeps runs and reports reproducible
+        std::sort(jobs.begin(), jobs.end(), [](const BatchJob &lhs, const BatchJob &rhs) {
+            return lhs.d_input < rhs.d_input;
+        });
+    } else {
+        std::ifstream manifest(input);
+        if (!manifest.is_open()) {
+            throw std::runtime_error("Failed to open file: " + input.string());
+        }
+
+        std::string line;
+        while (std::getline(manifest, line)) {
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            if (line.empty() || line.front() == '#') {
+                continue;
+            }
+
+            const auto tab = line.find('\t');
+            const std::filesystem::path path = line.substr(0, tab);
+            jobs.push_back({.d_input = path,
+                            .d_output = tab == std::string::npos
+                                            ? defaultOutput(path, outputDir, decodeFormat)
+                                            : std::filesystem::path(line.substr(tab + 1))});
+            isDefaultOutput.push_back(tab == std::string::npos);
+        }
+    }
+
+    // inputs sharing a stem, like a.png and a.ppm, keep their whole name in the output name
+    std::map<std::filesystem::path, std::size_t> numDefaultOutputs;
+    for (std::size_t job = 0; job < jobs.size(); ++job) {
+        numDefaultOutputs[jobs[job].d_output] += isDefaultOutput[job] ? 1 : 0;
+    }
+
+    for (std::size_t job = 0; job < jobs.size(); ++job) {
+        if (isDefaultOutput[job] && numDefaultOutputs[jobs[job].d_output] > 1) {
+            const auto extension = jobs[job].d_output.extension();
+            jobs[job].d_output = outputDir / jobs[job].d_input.filename();
+            jobs[job].d_output += extension;
+        }
+    }
+
+    // two jobs writing one file would race, whatever order they finish in
+    std::map<std::filesystem::path, const BatchJob *> writers;
+    for (const auto &job : jobs) {
+        const auto [writer, isNew] = writers.emplace(job.d_output, &job);
+        if (!isNew) {
+            throw std::runtime_error("Both " + writer->second->d_input.string() + " and " +
+                                     job.d_input.string() + " would be written to " +
+                                     job.d_output.string());
+        }
+    }
+
+    std::filesystem::create_directories(outputDir);
+    return jobs;
+}
+
+auto runBatch(const std::vector<BatchJob> &allJobs, const BatchOptions &options) -> BatchReport {
+    // an image read from disk, waiting for a codec thread
+    struct LoadedJob {
+        std::size_t d_index;
+        std::uintmax_t d_inputBytes;
+        FileStamp d_inputStamp; // taken before the input was read, if a state records the job
+        FileOutput d_input;
+    };
+
+    // a converted image waiting for a writer; 'd_output' views 'd_buffer', which moving the job
+    // between threads does not reallocate
+    struct ConvertedJob {
+        std::size_t d_index;
+        std::uintmax_t d_inputBytes;
+        FileStamp d_inputStamp;
+        std::uint64_t d_numPixels;
+        std::vector<Byte> d_buffer;
+        FileOutput d_output;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // only stamps are compared unless a time changed, so checking every job up front is cheap
+    // next to converting any of them
+    std::vector<BatchJob> jobs;
+    std::ranges::copy_if(allJobs, std::back_inserter(jobs), [&](const BatchJob &job) {
+        return !options.d_state || !options.d_state->isUpToDate(job);
+    });
+
+    const std::size_t numSkipped = allJobs.size() - jobs.size();
+    std::vector<std::optional<FileStamp>> inputStamps(jobs.size());
+    const auto duplicates =
+        options.d_deduplicate
+            ? removeDuplicateJobs(jobs, inputStamps, std::max(1u, options.d_numReaders))
+            : std::vector<std::vector<DuplicateJob>>(jobs.size());
+
+    const auto clampThreads = [&](unsigned int numThreads) {
+        return static_cast<unsigned int>(
+            std::max<std::size_t>(1, std::min<std::size_t>(numThreads, jobs.size())));
+    };
+
+    const unsigned int numReaders = clampThreads(options.d_numReaders);
+    const unsigned int numWorkers = clampThreads(
+        options.d_numWorkers > 0 ? options.d_numWorkers : std::thread::hardware_concurrency());
+    const unsigned int numWriters = clampThreads(options.d_numWriters);
+
+    BatchReport report{.d_numConverted = 0,
+                       .d_numSkipped = numSkipped,
+                       .d_numDeduplicated = 0,
+                       .d_inputBytes = 0,
+                       .d_outputBytes = 0,
+                       .d_numPixels = 0,
+                       .d_seconds = 0,
+                       .d_failures = {}};
+    std::mutex reportMutex;
+    const auto fail = [&](const BatchJob &job, std::string message) {
+        const std::lock_guard lock(reportMutex);
+        report.d_failures.push_back({.d_input = job.d_input, .d_message = std::move(message)});
+    };
+
+    // the duplicates of a job are only written once it is, so they fail along with it
+    const auto failWithDuplicates = [&](std::size_t index, const std::string &message) {
+        fail(jobs[index], message);
+        for (const auto &duplicate : duplicates[index]) {
+            fail(duplicate.d_job, message);
+        }
+    };
+
+    // each reader and writer of the io_uring backend moves a batch of files per submission
+    const bool useRing = options.d_ioBackend == IoBackend::IO_URING;
+    if (useRing && !IoRing::isAvailable()) {
+        throw std::runtime_error("io_uring is not available on this system");
+    }
+
+    const std::size_t ioBatchSize = useRing ? IO_BATCH_SIZE : 1;
+
+    std::vector<JobEstimate> estimates;
+    std::vector<std::uint64_t> costs;
+    estimates.reserve(jobs.size());
+    costs.reserve(jobs.size());
+    for (const auto &job : jobs) {
+        estimates.push_back(estimateJob(job));
+        costs.push_back(estimates.back().d_numPixels);
+    }
+
+    JobScheduler scheduler(costs);
+    MemoryBudget budget(options.d_maxMemory);
+
+    // a codec thread has at most one image waiting on each side, and the buffers of written
+    // images go back to the codec threads instead of being freed, unless memory is limited: a
+    // spare buffer would be memory the budget no longer accounts for
+    BoundedQueue<LoadedJob> toConvert(numWorkers);
+    BoundedQueue<ConvertedJob> toWrite(numWorkers);
+    BoundedQueue<std::vector<Byte>> spareBuffers(numWorkers);
+    if (options.d_maxMemory != 0) {
+        spareBuffers.close();
+    }
+
+    std::vector<std::jthread> readers;
+    for (unsigned int reader = 0; reader < numReaders; ++reader) {
+        readers.emplace_back([&] {
+            std::unique_ptr<IoRing> ring;
+            std::optional<std::size_t> carried;
+            std::vector<std::size_t> batch;
+            std::vector<std::filesystem::path> paths;
+            while (true) {
+                // the first job waits for memory; the others only join the batch while they fit
+                // at once, since memory held for jobs not read yet could starve the writers
+                batch.clear();
+                const auto first = carried ? carried : scheduler.next();
+                carried.reset();
+                if (!first) {
+                    break;
+                }
+
+                budget.acquire(estimates[*first].d_peakMemory);
+                batch.push_back(*first);
+                while (batch.size() < ioBatchSize) {
+                    const auto index = scheduler.next();
+                    if (!index) {
+                        break;
+                    }
+
+                    if (!budget.tryAcquire(estimates[*index].d_peakMemory)) {
+                        carried = index;
+                        break;
+                    }
+
+                    batch.push_back(*index);
+                }
+
+                // a recorded input is stamped before it is read, so that a change made while its
+                // job runs shows up as a different time next time
+                std::vector<std::int64_t> times(batch.size(), 0);
+                for (std::size_t position = 0; position < batch.size(); ++position) {
+                    if (options.d_state && !inputStamps[batch[position]]) {
+                        try {
+                            times[position] = fileTime(jobs[batch[position]].d_input);
+                        } catch (const std::exception &) {
+                            // reading the file reports what is wrong with it
+                        }
+                    }
+                }
+
+                // the bytes of a file are hashed where they already are, not read a second time
+                const auto stamp = [&](std::size_t position, std::span<const Byte> bytes) {
+                    const auto &known = inputStamps[batch[position]];
+                    if (known || !options.d_state) {
+                        return known.value_or(FileStamp{});
+                    }
+
+                    return FileStamp{.d_size = bytes.size(),
+                                     .d_modified = times[position],
+                                     .d_hash = hashContent(bytes)};
+                };
+
+                std::vector<FileRead> files;
+                if (useRing) {
+                    paths.clear();
+                    for (const auto index : batch) {
+                        paths.push_back(jobs[index].d_input);
+                    }
+
+                    // a ring that cannot be set up or fails takes its batch with it, and the next
+                    // batch tries a new one, e.g. once other threads gave memory back
+                    try {
+                        if (!ring) {
+                            ring = std::make_unique<IoRing>();
+                        }
+
+                        files = readFiles(*ring, paths);
+                    } catch (const std::exception &e) {
+                        ring.reset();
+                        for (const auto index : batch) {
+                            budget.release(estimates[index].d_peakMemory);
+                            failWithDuplicates(index, e.what());
+                        }
+
+                        continue;
+                    }
+                }
+
+                for (std::size_t position = 0; position < batch.size(); ++position) {
+                    const std::size_t index = batch[position];
+                    const BatchJob &job = jobs[index];
+                    try {
+                        if (!useRing) {
+                            // preloaded, so the codec threads never wait on the disk
+                            auto file = std::make_shared<const MappedFile>(job.d_input, true);
+                            const std::span<const Byte> bytes = file->bytes();
+                            const FileStamp inputStamp = stamp(position, bytes);
+                            toConvert.push({.d_index = index,
+                                            .d_inputBytes = bytes.size(),
+                                            .d_inputStamp = inputStamp,
+                                            .d_input = parseJobInput(job, bytes, std::move(file))});
+                        } else if (!files[position].d_error.empty()) {
+                            throw std::runtime_error(files[position].d_error);
+                        } else {
+                            const auto inputBytes = files[position].d_bytes.size();
+                            const FileStamp inputStamp = stamp(position, files[position].d_bytes);
+                            FileOutput input =
+                                parseJobInput(job, std::move(files[position].d_bytes));
+                            toConvert.push({.d_index = index,
+                                            .d_inputBytes = inputBytes,
+                                            .d_inputStamp = inputStamp,
+                                            .d_input = std::move(input)});
+                        }
+                    } catch (const std::exception &e) {
+                        budget.release(estimates[index].d_peakMemory);
+                        failWithDuplicates(index, e.what());
+                    }
+                }
+            }
+        });
+    }
+
+    std::vector<std::jthread> workers;
+    for (unsigned int worker = 0; worker < numWorkers; ++worker) {
+        workers.emplace_back([&] {
+            while (auto loaded = toConvert.pop()) {
+                const std::size_t index = loaded->d_index;
+                const BatchJob &job = jobs[index];
+                try {
+                    ConvertedJob converted{
+                        .d_index = index,
+                        .d_inputBytes = loaded->d_inputBytes,
+                        .d_inputStamp = loaded->d_inputStamp,
+                        .d_numPixels =
+                            static_cast<std::uint64_t>(loaded->d_input.d_width) *
+                            loaded->d_input.d_height,
+                        .d_buffer = spareBuffers.tryPop().value_or(std::vector<Byte>()),
+                        .d_output = {}};
+                    converted.d_output =
+                        convertJobInput(job, loaded->d_input, converted.d_buffer);
+
+                    // the input is not needed any more, so it is released before waiting
+                    loaded.reset();
+                    toWrite.push(std::move(converted));
+                } catch (const std::exception &e) {
+                    budget.release(estimates[index].d_peakMemory);
+                    failWithDuplicates(index, e.what());
+                }
+            }
+        });
+    }
+
+    std::vector<std::jthread> writers;
+    for (unsigned int writer = 0; writer < numWriters; ++writer) {
+        writers.emplace_back([&] {
+            std::unique_ptr<IoRing> ring;
+            std::vector<ConvertedJob> batch;
+            std::vector<std::vector<Byte>> scratch(ioBatchSize);
+
+            // every writer tallies on its own and merges once, so the jobs never contend
+            BatchReport local{.d_numConverted = 0,
+                              .d_numSkipped = 0,
+                              .d_numDeduplicated = 0,
+                              .d_inputBytes = 0,
+                              .d_outputBytes = 0,
+                              .d_numPixels = 0,
+                              .d_seconds = 0,
+                              .d_failures = {}};
+            while (auto first = toWrite.pop()) {
+                batch.clear();
+                batch.push_back(std::move(*first));
+                while (batch.size() < ioBatchSize) {
+                    auto next = toWrite.tryPop();
+                    if (!next) {
+                        break;
+                    }
+
+                    batch.push_back(std::move(*next));
+                }
+
+                std::vector<std::string> errors(batch.size());
+                std::vector<std::uintmax_t> outputBytes(batch.size(), 0);
+                std::vector<FileWrite> writes;
+                std::vector<std::size_t> positions;
+                for (std::size_t position = 0; position < batch.size(); ++position) {
+                    const BatchJob &job = jobs[batch[position].d_index];
+                    try {
+                        detachOutput(job.d_output);
+                        writes.push_back(
+                            prepareWrite(job, batch[position].d_output, scratch[position]));
+                        positions.push_back(position);
+                        for (const auto &piece : writes.back().d_pieces) {
+                            outputBytes[position] += piece.size();
+                        }
+                    } catch (const std::exception &e) {
+                        errors[position] = e.what();
+                    }
+                }
+
+                if (useRing) {
+                    try {
+                        if (!ring) {
+                            ring = std::make_unique<IoRing>();
+                        }
+
+                        auto written = writeFiles(*ring, writes);
+                        for (std::size_t write = 0; write < writes.size(); ++write) {
+                            errors[positions[write]] = std::move(written[write]);
+                        }
+                    } catch (const std::exception &e) {
+                        ring.reset();
+                        for (const auto position : positions) {
+                            errors[position] = e.what();
+                        }
+                    }
+                } else {
+                    for (std::size_t write = 0; write < writes.size(); ++write) {
+                        try {
+                            writeFile(writes[write]);
+                        } catch (const std::exception &e) {
+                            errors[positions[write]] = e.what();
+                        }
+                    }
+                }
+
+                std::vector<FileStamp> outputStamps(batch.size());
+                for (std::size_t write = 0; write < writes.size(); ++write) {
+                    const std::size_t position = positions[write];
+                    if (errors[position].empty() && options.d_state) {
+                        try {
+                            outputStamps[position] = stampWrite(writes[write]);
+                            options.d_state->record(jobs[batch[position].d_index],
+                                                    batch[position].d_inputStamp,
+                                                    outputStamps[position]);
+                        } catch (const std::exception &e) {
+                            errors[position] = e.what();
+                        }
+                    }
+                }
+
+                for (std::size_t position = 0; position < batch.size(); ++position) {
+                    ConvertedJob &converted = batch[position];
+                    const BatchJob &job = jobs[converted.d_index];
+
+                    if (!errors[position].empty()) {
+                        failWithDuplicates(converted.d_index, errors[position]);
+                    } else {
+                        local.d_inputBytes += converted.d_inputBytes;
+                        local.d_outputBytes += outputBytes[position];
+                        local.d_numPixels += converted.d_numPixels;
+                        ++local.d_numConverted;
+                        for (const auto &duplicate : duplicates[converted.d_index]) {
+                            try {
+                                linkOutput(job.d_output, duplicate.d_job.d_output);
+                                if (options.d_state) {
+                                    FileStamp outputStamp = outputStamps[position];
+                                    outputStamp.d_modified = fileTime(duplicate.d_job.d_output);
+                                    options.d_state->record(duplicate.d_job,
+                                                            duplicate.d_inputStamp, outputStamp);
+                                }
+
+                                ++local.d_numDeduplicated;
+                            } catch (const std::exception &e) {
+                                fail(duplicate.d_job, e.what());
+                            }
+                        }
+                    }
+
+                    spareBuffers.tryPush(std::move(converted.d_buffer));
+                    budget.release(estimates[converted.d_index].d_peakMemory);
+                }
+            }
+
+            const std::lock_guard lock(reportMutex);
+            report.d_numConverted += local.d_numConverted;
+            report.d_numDeduplicated += local.d_numDeduplicated;
+            report.d_inputBytes += local.d_inputBytes;
+            report.d_outputBytes += local.d_outputBytes;
+            report.d_numPixels += local.d_numPixels;
+        });
+    }
+
+    // each stage ends once the one before it has finished and its queue is drained
+    for (auto &reader : readers) {
+        reader.join();
+    }
+
+    toConvert.close();
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    toWrite.close();
+    for (auto &writer : writers) {
+        writer.join();
+    }
+
+    report.d_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+auto parseIoBackend(std::string_view name) -> IoBackend {
+    if (name == "blocking") {
+        return IoBackend::BLOCKING;
+    }
+
+    if (name == "uring") {
+        return IoBackend::IO_URING;
+    }
+
+    throw std::runtime_error("Unknown I/O backend: " + std::string(name) +
+                             ". Supported: blocking, uring");
+}
+} // namespace qoi
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <qoi_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace qoi {
+class BatchState;
+
+// One file to convert. A QOI input is decoded to the PPM or PNG format named by the extension of
+// the output, and a PPM or PNG input is encoded to QOI.
+struct BatchJob {
+    std::filesystem::path d_input;
+    std::filesystem::path d_output;
+};
+
+struct BatchFailure {
+    std::filesystem::path d_input;
+    std::string d_message;
+};
+
+// How the batch pipeline reads and writes files.
+enum class IoBackend : std::uint8_t {
+    BLOCKING, // one blocking call after the other, on every system
+    IO_URING  // up to 32 files per submission through a Linux io_uring
+};
+
+// How the batch pipeline runs. Bounded queues between the reader, codec and writer threads let
+// the disk work overlap the conversion without reading further ahead than the codecs can take.
+struct BatchOptions {
+    unsigned int d_numReaders; // threads reading inputs (at least 1)
+    unsigned int d_numWorkers; // threads encoding or decoding, 0 means one per hardware thread
+    unsigned int d_numWriters; // threads writing outputs (at least 1)
+    std::uint64_t d_maxMemory; // bytes the jobs in flight may hold together by their estimates,
+                               // 0 for no limit; a job larger than the limit runs alone
+    IoBackend d_ioBackend;
+    bool d_deduplicate;  // convert inputs with the same content once and link the other outputs
+    BatchState *d_state; // jobs converted before, to skip if unchanged and to record, or null
+};
+
+// The work and memory a job takes, known before it starts.
+struct JobEstimate {
+    std::uint64_t d_numPixels;  // pixels converted, the cost the scheduler orders jobs by
+    std::uint64_t d_peakMemory; // bytes held at once while the job is read, converted and written
+};
+
+// What a batch converted and how long it took.
+struct BatchReport {
+    std::size_t d_numConverted;
+    std::size_t d_numSkipped; // jobs left alone since their files had not changed
+    std::size_t d_numDeduplicated; // jobs written from the output of another with the same input
+    std::uintmax_t d_inputBytes;
+    std::uintmax_t d_outputBytes;
+    std::uint64_t d_numPixels;
+    double d_seconds;
+    std::vector<BatchFailure> d_failures;
+};
+
+// Read the input of 'job' from disk: the pixels of a PPM or PNG file, or the ops of a QOI file,
+// preloaded so that converting them does no I/O. Throws if the input cannot be read or 'job'
+// asks for a conversion that is not supported.
+auto readJobInput(const BatchJob &job) -> FileOutput;
+
+// Return the input of 'job' like 'readJobInput' does, from the whole input file 'file' already in
+// memory. The pixels of a PPM or the ops of a QOI file are not copied but kept in 'file'.
+auto parseJobInput(const BatchJob &job, std::vector<Byte> file) -> FileOutput;
+
+// Return the input of 'job' like 'parseJobInput' does, from the whole input file 'bytes', which
+// 'storage' keeps alive for as long as the result needs them.
+auto parseJobInput(const BatchJob &job, std::span<const Byte> bytes,
+                   std::shared_ptr<const void> storage) -> FileOutput;
+
+// Convert 'input', as returned by 'readJobInput(job)', into 'buffer' with the encoder or decoder
+// of the calling thread, and return a view of the result: the QOI file, or the pixels to write
+// as PPM or PNG. The view does not own its bytes and is valid as long as 'buffer' is unchanged.
+auto convertJobInput(const BatchJob &job, const FileOutput &input, std::vector<Byte> &buffer)
+    -> FileOutput;
+
+// Write 'output', as returned by 'convertJobInput', to the output file of 'job'.
+auto writeJobOutput(const BatchJob &job, const FileOutput &output) -> void;
+
+// Read, convert and write 'job' on the calling thread and return the number of pixels in the
+// image. The codecs and buffers of the thread are reused from one call to the next. Throws on
+// failure.
+auto convertFile(const BatchJob &job) -> std::uint64_t;
+
+// Return the size of 'job' estimated from the header of its input alone: the QOI or PPM header,
+// or the PNG header through stb. Both numbers are 0 if the input cannot be read, since such a
+// job fails at once.
+auto estimateJob(const BatchJob &job) -> JobEstimate;
+
+// Return the jobs for 'input', which is either a directory or a manifest file. Every QOI, PPM and
+// PNG file directly inside a directory is converted into 'outputDir' under the same stem, QOI
+// files to 'decodeFormat' ("ppm" or "png") and the others to QOI. A manifest lists one input
+// path per line, optionally followed by a tab and the output path; a line without an output is
+// converted into 'outputDir' like a directory entry. Empty lines and lines starting with '#' are
+// skipped. Inputs that share a stem, like "a.png" and "a.ppm", are written under their whole
+// name, e.g. "a.png.qoi" and "a.ppm.qoi". Throws if two jobs would still write the same file.
+auto listBatchJobs(const std::filesystem::path &input, const std::filesystem::path &outputDir,
+                   std::string_view decodeFormat) -> std::vector<BatchJob>;
+
+// Convert every job in 'jobs' on the pipeline described by 'options', largest images first, and
+// report what was converted, skipped and deduplicated. A job that fails is recorded in the report
+// and does not stop the others. Throws if the io_uring backend is asked for but not available.
+auto runBatch(const std::vector<BatchJob> &jobs, const BatchOptions &options) -> BatchReport;
+
+// Return the backend named 'name' ("blocking" or "uring"). Throws if the name is unknown.
+auto parseIoBackend(std::string_view name) -> IoBackend;
+} // namespace qoi
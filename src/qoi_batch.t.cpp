@@ -0,0 +1,277 @@
+#include <qoi_batch.h>
+#include <qoi_batchstate.h>
+#include <qoi_ioring.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+// A scratch directory that is removed again when the test ends.
+struct ScratchDirectory {
+    std::filesystem::path d_path;
+
+    explicit ScratchDirectory(const std::string &name)
+        : d_path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(d_path);
+        std::filesystem::create_directories(d_path);
+    }
+
+    ~ScratchDirectory() { std::filesystem::remove_all(d_path); }
+};
+
+auto makeNoise(Width width, Height height, unsigned int seed) -> FileOutput {
+    std::mt19937 generator(seed);
+    std::vector<Byte> bytes(static_cast<std::size_t>(width) * height * 3);
+    for (auto &byte : bytes) {
+        byte = static_cast<Byte>(generator() % 4);
+    }
+
+    return makeFileOutput(width, height, 3, 0, std::move(bytes));
+}
+} // namespace
+
+TEST(BatchTest, encodesAndDecodesEveryFileOfADirectory) {
+    const ScratchDirectory scratch("qoi_batch_test_directory");
+    const auto images = scratch.d_path / "images";
+    std::filesystem::create_directories(images);
+
+    std::vector<FileOutput> originals;
+    for (unsigned int iter = 0; iter < 5; ++iter) {
+        originals.push_back(makeNoise(17 + iter, 9 + iter, iter));
+        writeToPPMFile(images / ("image" + std::to_string(iter) + ".ppm"), originals.back());
+    }
+
+    const auto encoded = scratch.d_path / "encoded";
+    const auto encodeJobs = listBatchJobs(images, encoded, "ppm");
+    ASSERT_EQ(encodeJobs.size(), originals.size());
+    EXPECT_EQ(encodeJobs[0].d_output, encoded / "image0.qoi");
+    EXPECT_EQ(estimateJob(encodeJobs[4]).d_numPixels, 21u * 13u);
+    EXPECT_EQ(estimateJob(encodeJobs[4]).d_peakMemory, 21u * 13u * 3 + maxEncodedSize(21, 13, 3));
+
+    const BatchReport encodeReport =
+        runBatch(encodeJobs, {.d_numReaders = 2,
+                              .d_numWorkers = 3,
+                              .d_numWriters = 1,
+                              .d_maxMemory = 0,
+                              .d_ioBackend = IoBackend::BLOCKING,
+                              .d_deduplicate = false,
+                              .d_state = nullptr});
+    EXPECT_EQ(encodeReport.d_numConverted, originals.size());
+    EXPECT_TRUE(encodeReport.d_failures.empty());
+
+    const auto decoded = scratch.d_path / "decoded";
+    const auto decodeJobs = listBatchJobs(encoded, decoded, "ppm");
+    EXPECT_EQ(estimateJob(decodeJobs[4]).d_numPixels, 21u * 13u);
+
+    // a budget smaller than any image lets one job through at a time
+    const BatchReport decodeReport =
+        runBatch(decodeJobs, {.d_numReaders = 2,
+                              .d_numWorkers = 0,
+                              .d_numWriters = 2,
+                              .d_maxMemory = 1,
+                              .d_ioBackend = IoBackend::BLOCKING,
+                              .d_deduplicate = false,
+                              .d_state = nullptr});
+    EXPECT_EQ(decodeReport.d_numConverted, originals.size());
+    EXPECT_EQ(decodeReport.d_numPixels, encodeReport.d_numPixels);
+
+    for (std::size_t iter = 0; iter < originals.size(); ++iter) {
+        const FileOutput image = readPPMFile(decoded / ("image" + std::to_string(iter) + ".ppm"));
+        EXPECT_TRUE(std::equal(image.d_bytes.begin(), image.d_bytes.end(),
+                               originals[iter].d_bytes.begin(), originals[iter].d_bytes.end()));
+    }
+}
+
+TEST(BatchTest, readsManifestAndReportsFailedFiles) {
+    const ScratchDirectory scratch("qoi_batch_test_manifest");
+    writeToPPMFile(scratch.d_path / "good.ppm", makeNoise(8, 8, 1));
+
+    const auto manifest = scratch.d_path / "manifest.txt";
+    std::ofstream(manifest) << "# comment\n"
+                            << (scratch.d_path / "good.ppm").string() << '\t'
+                            << (scratch.d_path / "renamed.qoi").string() << "\n\n"
+                            << (scratch.d_path / "missing.ppm").string() << '\n';
+
+    const auto jobs = listBatchJobs(manifest, scratch.d_path / "out", "png");
+    ASSERT_EQ(jobs.size(), 2u);
+    EXPECT_EQ(estimateJob(jobs[1]).d_peakMemory, 0u);
+    EXPECT_EQ(jobs[1].d_output, scratch.d_path / "out" / "missing.qoi");
+
+    const BatchReport report =
+        runBatch(jobs, {.d_numReaders = 1,
+                        .d_numWorkers = 2,
+                        .d_numWriters = 1,
+                        .d_maxMemory = 0,
+                        .d_ioBackend = IoBackend::BLOCKING,
+                        .d_deduplicate = false,
+                        .d_state = nullptr});
+    EXPECT_EQ(report.d_numConverted, 1u);
+    ASSERT_EQ(report.d_failures.size(), 1u);
+    EXPECT_EQ(report.d_failures[0].d_input, scratch.d_path / "missing.ppm");
+    EXPECT_TRUE(std::filesystem::exists(scratch.d_path / "renamed.qoi"));
+}
+
+TEST(BatchTest, failsAQOIFileWhoseHeaderClaimsMorePixelsThanItHolds) {
+    const ScratchDirectory scratch("qoi_batch_test_lying_header");
+    const auto images = scratch.d_path / "images";
+    std::filesystem::create_directories(images);
+
+    // 65535 x 65535 pixels would take 16GB to decode into, from a stream of a single op
+    const std::vector<Byte> lying = {'q', 'o', 'i', 'f', 0, 0, 0xff, 0xff, 0, 0, 0xff, 0xff, 3, 0,
+                                     0xfd, 0, 0, 0, 0, 0, 0, 0, 1};
+    std::ofstream(images / "lying.qoi", std::ios::binary)
+        .write(reinterpret_cast<const char *>(lying.data()), lying.size());
+    writeToPPMFile(images / "good.ppm", makeNoise(8, 8, 2));
+
+    const BatchReport report = runBatch(listBatchJobs(images, scratch.d_path / "out", "ppm"),
+                                        {.d_numReaders = 1,
+                                         .d_numWorkers = 2,
+                                         .d_numWriters = 1,
+                                         .d_maxMemory = 0,
+                                         .d_ioBackend = IoBackend::BLOCKING,
+                                         .d_deduplicate = false,
+                                         .d_state = nullptr});
+    EXPECT_EQ(report.d_numConverted, 1u);
+    ASSERT_EQ(report.d_failures.size(), 1u);
+    EXPECT_EQ(report.d_failures[0].d_input, images / "lying.qoi");
+    EXPECT_FALSE(std::filesystem::exists(scratch.d_path / "out" / "lying.ppm"));
+}
+
+TEST(BatchTest, skipsJobsTheStateRecordedAsUpToDate) {
+    const ScratchDirectory scratch("qoi_batch_test_state");
+    const auto images = scratch.d_path / "images";
+    std::filesystem::create_directories(images);
+    for (unsigned int iter = 0; iter < 4; ++iter) {
+        writeToPPMFile(images / ("image" + std::to_string(iter) + ".ppm"), makeNoise(6, 6, iter));
+    }
+
+    const auto jobs = listBatchJobs(images, scratch.d_path / "encoded", "ppm");
+    const auto run = [&] {
+        BatchState state(scratch.d_path / "state");
+        return runBatch(jobs, {.d_numReaders = 1,
+                               .d_numWorkers = 2,
+                               .d_numWriters = 1,
+                               .d_maxMemory = 0,
+                               .d_ioBackend = IoBackend::BLOCKING,
+                               .d_deduplicate = false,
+                               .d_state = &state});
+    };
+
+    EXPECT_EQ(run().d_numConverted, 4u);
+
+    writeToPPMFile(jobs[2].d_input, makeNoise(7, 6, 2));
+    std::filesystem::remove(jobs[3].d_output);
+    const BatchReport report = run();
+    EXPECT_EQ(report.d_numConverted, 2u);
+    EXPECT_EQ(report.d_numSkipped, 2u);
+    EXPECT_EQ(readQOIFile(jobs[2].d_output).d_width, 7u);
+    EXPECT_TRUE(std::filesystem::exists(jobs[3].d_output));
+}
+
+TEST(BatchTest, convertsInputsWithTheSameContentOnce) {
+    const ScratchDirectory scratch("qoi_batch_test_dedup");
+    const auto images = scratch.d_path / "images";
+    std::filesystem::create_directories(images);
+    writeToPPMFile(images / "a.ppm", makeNoise(9, 5, 1));
+    writeToPPMFile(images / "c.ppm", makeNoise(9, 5, 2));
+    std::filesystem::copy_file(images / "a.ppm", images / "b.ppm");
+
+    const auto jobs = listBatchJobs(images, scratch.d_path / "encoded", "ppm");
+    const BatchOptions options{.d_numReaders = 2,
+                               .d_numWorkers = 2,
+                               .d_numWriters = 2,
+                               .d_maxMemory = 0,
+                               .d_ioBackend = IoBackend::BLOCKING,
+                               .d_deduplicate = true,
+                               .d_state = nullptr};
+    const BatchReport report = runBatch(jobs, options);
+    EXPECT_EQ(report.d_numConverted, 2u);
+    EXPECT_EQ(report.d_numDeduplicated, 1u);
+
+    const FileOutput first = readQOIFile(jobs[0].d_output);
+    const FileOutput second = readQOIFile(jobs[1].d_output);
+    EXPECT_TRUE(std::equal(first.d_bytes.begin(), first.d_bytes.end(), second.d_bytes.begin(),
+                           second.d_bytes.end()));
+
+    // converting a changed input again leaves the output it was linked to alone
+    writeToPPMFile(images / "a.ppm", makeNoise(3, 3, 3));
+    EXPECT_EQ(runBatch({jobs[0]}, options).d_numConverted, 1u);
+    EXPECT_EQ(readQOIFile(jobs[0].d_output).d_width, 3u);
+    EXPECT_EQ(readQOIFile(jobs[1].d_output).d_width, 9u);
+}
+
+TEST(BatchTest, ioUringBackendMatchesBlockingBackend) {
+    if (!IoRing::isAvailable()) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    const ScratchDirectory scratch("qoi_batch_test_io_uring");
+    const auto images = scratch.d_path / "images";
+    std::filesystem::create_directories(images);
+    for (unsigned int iter = 0; iter < 40; ++iter) {
+        writeToPPMFile(images / ("image" + std::to_string(iter) + ".ppm"),
+                       makeNoise(5 + iter, 3 + iter % 7, iter));
+    }
+
+    for (const char *format : {"ppm", "png"}) {
+        const auto blocking = scratch.d_path / (std::string("blocking_") + format);
+        const auto uring = scratch.d_path / (std::string("uring_") + format);
+        for (const auto &[output, backend] :
+             {std::pair{blocking, IoBackend::BLOCKING}, std::pair{uring, IoBackend::IO_URING}}) {
+            const auto encoded = output / "encoded";
+            const BatchOptions options{.d_numReaders = 2,
+                                       .d_numWorkers = 2,
+                                       .d_numWriters = 2,
+                                       .d_maxMemory = 0,
+                                       .d_ioBackend = backend,
+                                       .d_deduplicate = false,
+                                       .d_state = nullptr};
+            EXPECT_EQ(runBatch(listBatchJobs(images, encoded, format), options).d_numConverted,
+                      40u);
+            EXPECT_EQ(runBatch(listBatchJobs(encoded, output / "decoded", format), options)
+                          .d_numConverted,
+                      40u);
+        }
+
+        for (const auto &entry : std::filesystem::directory_iterator(blocking / "decoded")) {
+            const FileOutput lhs = readJobInput({.d_input = entry.path(), .d_output = "x.qoi"});
+            const FileOutput rhs = readJobInput(
+                {.d_input = uring / "decoded" / entry.path().filename(), .d_output = "x.qoi"});
+            EXPECT_TRUE(std::equal(lhs.d_bytes.begin(), lhs.d_bytes.end(), rhs.d_bytes.begin(),
+                                   rhs.d_bytes.end()));
+        }
+    }
+}
+
+TEST(BatchTest, keepsOutputsOfInputsSharingAStemApart) {
+    const ScratchDirectory scratch("qoi_batch_test_stems");
+    writeToPPMFile(scratch.d_path / "image.ppm", makeNoise(4, 4, 1));
+    writeToPPMFile(scratch.d_path / "other.ppm", makeNoise(4, 4, 2));
+    std::filesystem::copy_file(scratch.d_path / "image.ppm", scratch.d_path / "image.png");
+
+    const auto out = scratch.d_path / "out";
+    const auto jobs = listBatchJobs(scratch.d_path, out, "ppm");
+    ASSERT_EQ(jobs.size(), 3u);
+    EXPECT_EQ(jobs[0].d_output, out / "image.png.qoi");
+    EXPECT_EQ(jobs[1].d_output, out / "image.ppm.qoi");
+    EXPECT_EQ(jobs[2].d_output, out / "other.qoi");
+
+    const auto manifest = scratch.d_path / "manifest.txt";
+    std::ofstream(manifest) << (scratch.d_path / "image.ppm").string() << '\t'
+                            << (out / "same.qoi").string() << '\n'
+                            << (scratch.d_path / "other.ppm").string() << '\t'
+                            << (out / "same.qoi").string() << '\n';
+    EXPECT_THROW(listBatchJobs(manifest, out, "ppm"), std::runtime_error);
+}
@@ -0,0 +1,221 @@
+#include <qoi_batchstate.h>
+
+#include <qoi_hash.h>
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+namespace qoi {
+namespace {
+// Return whether 'filename' still matches 'stamp'. The content is only hashed when the size
+// matches but the time does not, e.g. after the file was copied or touched.
+auto isUnchanged(const std::filesystem::path &filename, const FileStamp &stamp) -> bool {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    if (error || size != stamp.d_size) {
+        return false;
+    }
+
+    const auto modified = std::filesystem::last_write_time(filename, error);
+    if (error) {
+        return false;
+    }
+
+    if (modified.time_since_epoch().count() == stamp.d_modified) {
+        return true;
+    }
+
+    try {
+        return hashFile(filename) == stamp.d_hash;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+// Return 'path' with the tabs and line breaks that separate the fields and lines of the state
+// file escaped, along with the backslash that escapes them, since a file name may hold any of them.
+auto quotePath(const std::filesystem::path &path) -> std::string {
+    std::string quoted;
+    for (const char character : path.string()) {
+        switch (character) {
+        case '\\':
+            quoted += "\\\\";
+            break;
+        case '\t':
+            quoted += "\\t";
+            break;
+        case '\n':
+            quoted += "\\n";
+            break;
+        default:
+            quoted += character;
+        }
+    }
+
+    return quoted;
+}
+
+// Undo 'quotePath'. Return false if 'text' holds an escape 'quotePath' does not write.
+auto unquotePath(std::string_view text, std::filesystem::path &path) -> bool {
+    std::string unquoted;
+    for (std::size_t index = 0; index < text.size(); ++index) {
+        if (text[index] != '\\') {
+            unquoted += text[index];
+            continue;
+        }
+
+        if (++index == text.size()) {
+            return false;
+        }
+
+        switch (text[index]) {
+        case '\\':
+            unquoted += '\\';
+            break;
+        case 't':
+            unquoted += '\t';
+            break;
+        case 'n':
+            unquoted += '\n';
+            break;
+        default:
+            return false;
+        }
+    }
+
+    path = unquoted;
+    return true;
+}
+
+auto writeStamp(std::ostream &out, const FileStamp &stamp) -> void {
+    out << '\t' << stamp.d_size << '\t' << stamp.d_modified << '\t' << std::hex << stamp.d_hash
+        << std::dec;
+}
+
+template <class T>
+auto parseNumber(std::string_view text, T &value, int base = 10) -> bool {
+    const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value, base);
+    return error == std::errc() && end == text.data() + text.size();
+}
+
+auto parseStamp(const std::vector<std::string_view> &fields, std::size_t first, FileStamp &stamp)
+    -> bool {
+    return parseNumber(fields[first], stamp.d_size) &&
+           parseNumber(fields[first + 1], stamp.d_modified) &&
+           parseNumber(fields[first + 2], stamp.d_hash, 16);
+}
+} // namespace
+
+auto fileTime(const std::filesystem::path &filename) -> std::int64_t {
+    return std::filesystem::last_write_time(filename).time_since_epoch().count();
+}
+
+auto stampFile(const std::filesystem::path &filename) -> FileStamp {
+    return {.d_size = std::filesystem::file_size(filename),
+            .d_modified = fileTime(filename),
+            .d_hash = hashFile(filename)};
+}
+
+// CREATORS
+BatchState::BatchState(const std::filesystem::path &filename)
+    : d_mutex(), d_records(), d_journal() {
+    if (std::ifstream in{filename}) {
+        std::string line;
+        while (std::getline(in, line)) {
+            std::vector<std::string_view> fields;
+            for (std::size_t start = 0; start <= line.size();) {
+                const auto tab = std::min(line.find('\t', start), line.size());
+                fields.emplace_back(line.data() + start, tab - start);
+                start = tab + 1;
+            }
+
+            // a line cut short by a crash does not parse, or stamps a file in a way that will
+            // not match it, so the job is only converted again
+            Record record{};
+            std::filesystem::path input;
+            if (fields.size() == 8 && unquotePath(fields[0], input) &&
+                unquotePath(fields[4], record.d_output) &&
+                parseStamp(fields, 1, record.d_inputStamp) &&
+                parseStamp(fields, 5, record.d_outputStamp)) {
+                d_records[input] = std::move(record);
+            }
+        }
+    }
+
+    // start from a compact file, so that it does not grow with every run
+    auto compact = filename;
+    compact += ".tmp";
+    {
+        std::ofstream out{compact, std::ios::trunc};
+        for (const auto &[input, record] : d_records) {
+            out << quotePath(input);
+            writeStamp(out, record.d_inputStamp);
+            out << '\t' << quotePath(record.d_output);
+            writeStamp(out, record.d_outputStamp);
+            out << '\n';
+        }
+
+        if (!out.flush()) {
+            throw std::runtime_error("Failed to write file: " + compact.string());
+        }
+    }
+
+    std::filesystem::rename(compact, filename);
+    d_journal.open(filename, std::ios::app);
+    if (!d_journal.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filename.string());
+    }
+}
+
+// PRIVATE MANIPULATORS
+void BatchState::append(const std::filesystem::path &input, const Record &record) {
+    d_journal << quotePath(input);
+    writeStamp(d_journal, record.d_inputStamp);
+    d_journal << '\t' << quotePath(record.d_output);
+    writeStamp(d_journal, record.d_outputStamp);
+    d_journal << '\n';
+
+    // flushed line by line, so that a crash loses at most the job being written
+    if (!d_journal.flush()) {
+        throw std::runtime_error("Failed to write the batch state");
+    }
+}
+
+// MANIPULATORS
+void BatchState::record(const BatchJob &job, const FileStamp &inputStamp,
+                        const FileStamp &outputStamp) {
+    const Record record{
+        .d_output = job.d_output, .d_inputStamp = inputStamp, .d_outputStamp = outputStamp};
+
+    const std::lock_guard lock(d_mutex);
+    append(job.d_input, record);
+    d_records[job.d_input] = record;
+}
+
+// ACCESSORS
+bool BatchState::isUpToDate(const BatchJob &job) const {
+    Record record;
+    {
+        const std::lock_guard lock(d_mutex);
+        const auto found = d_records.find(job.d_input);
+        if (found == d_records.end()) {
+            return false;
+        }
+
+        record = found->second;
+    }
+
+    return record.d_output == job.d_output && isUnchanged(job.d_input, record.d_inputStamp) &&
+           isUnchanged(job.d_output, record.d_outputStamp);
+}
+
+std::size_t BatchState::size() const {
+    const std::lock_guard lock(d_mutex);
+    return d_records.size();
+}
+} // namespace qoi
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <qoi_batch.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+namespace qoi {
+// What a file looked like when it was last seen: a cheap stamp of its size and modification time,
+// and the hash of its content to fall back on when the time changed but the content may not have.
+struct FileStamp {
+    std::uintmax_t d_size;
+    std::int64_t d_modified; // modification time in ticks of the file clock
+    std::uint64_t d_hash;    // 'hashFile' of the content
+};
+
+// The inputs and outputs of every job a batch converted, kept in a state file so that a later
+// batch skips the jobs whose files have not changed since. Each converted job is appended to the
+// file and flushed right away, so a batch that crashes or is killed resumes where it stopped.
+// The file is text with one job per line, the input and output path each followed by the size,
+// time and hash of the file, separated by tabs. A tab, line break or backslash in a path is
+// written as "\t", "\n" or "\\". A line cut short by a crash is ignored, and a later line for the
+// same input replaces an earlier one.
+class BatchState {
+    // TYPES
+    struct Record {
+        std::filesystem::path d_output;
+        FileStamp d_inputStamp;
+        FileStamp d_outputStamp;
+    };
+
+    // DATA
+    mutable std::mutex d_mutex;
+    std::map<std::filesystem::path, Record> d_records; // by input path
+    std::ofstream d_journal;
+
+    // PRIVATE MANIPULATORS
+    void append(const std::filesystem::path &input, const Record &record);
+
+  public:
+    // CREATORS
+
+    // Load the state file 'filename', or start an empty one if it does not exist, and rewrite it
+    // with one line per input. Throws if the file cannot be written.
+    explicit BatchState(const std::filesystem::path &filename);
+
+    // MANIPULATORS
+
+    // Record that 'job' was converted from an input stamped 'inputStamp' to an output stamped
+    // 'outputStamp'. The input must be stamped before it was read, so that a change made while the
+    // job ran shows up as a different input next time. Safe to call from several threads at once.
+    void record(const BatchJob &job, const FileStamp &inputStamp, const FileStamp &outputStamp);
+
+    // ACCESSORS
+
+    // Return whether 'job' was converted before and neither its input nor its output has changed
+    // since: each still has its recorded size and either its recorded time or, if only the time
+    // changed, its recorded content.
+    bool isUpToDate(const BatchJob &job) const;
+
+    // Return the number of inputs recorded.
+    std::size_t size() const;
+};
+
+// Return the modification time of the file 'filename' as a 'FileStamp' holds it. Throws if it
+// cannot be read.
+auto fileTime(const std::filesystem::path &filename) -> std::int64_t;
+
+// Return the stamp of the file 'filename' as it is now, reading the whole file to hash it. Throws
+// if it cannot be read.
+auto stampFile(const std::filesystem::path &filename) -> FileStamp;
+} // namespace qoi
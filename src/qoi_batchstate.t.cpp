@@ -0,0 +1,133 @@
+#include <qoi_batch.h>
+#include <qoi_batchstate.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace qoi;
+
+namespace {
+// A scratch directory that is removed again when the test ends.
+struct ScratchDirectory {
+    std::filesystem::path d_path;
+
+    explicit ScratchDirectory(const std::string &name)
+        : d_path(std::filesystem::temp_directory_path() / name) {
+        std::filesystem::remove_all(d_path);
+        std::filesystem::create_directories(d_path);
+    }
+
+    ~ScratchDirectory() { std::filesystem::remove_all(d_path); }
+};
+
+auto writeText(const std::filesystem::path &path, const std::string &text) -> void {
+    std::ofstream(path, std::ios::binary) << text;
+}
+} // namespace
+
+TEST(BatchStateTest, skipsRecordedJobsUntilAFileChanges) {
+    const ScratchDirectory scratch("qoi_batchstate_test_record");
+    const BatchJob job{.d_input = scratch.d_path / "a.ppm", .d_output = scratch.d_path / "a.qoi"};
+    const auto stateFile = scratch.d_path / "state";
+    writeText(job.d_input, "input");
+    writeText(job.d_output, "output");
+
+    {
+        BatchState state(stateFile);
+        EXPECT_EQ(state.size(), 0u);
+        EXPECT_FALSE(state.isUpToDate(job));
+        state.record(job, stampFile(job.d_input), stampFile(job.d_output));
+        EXPECT_TRUE(state.isUpToDate(job));
+        EXPECT_FALSE(state.isUpToDate({.d_input = job.d_input, .d_output = job.d_input}));
+    }
+
+    // a touched file with the same content is still up to date, one with new content is not
+    BatchState state(stateFile);
+    EXPECT_EQ(state.size(), 1u);
+    EXPECT_TRUE(state.isUpToDate(job));
+
+    std::filesystem::last_write_time(job.d_input, std::filesystem::last_write_time(job.d_input) +
+                                                      std::chrono::seconds(10));
+    EXPECT_TRUE(state.isUpToDate(job));
+
+    writeText(job.d_input, "INPUT");
+    EXPECT_FALSE(state.isUpToDate(job));
+    state.record(job, stampFile(job.d_input), stampFile(job.d_output));
+    EXPECT_TRUE(state.isUpToDate(job));
+
+    std::filesystem::remove(job.d_output);
+    EXPECT_FALSE(state.isUpToDate(job));
+}
+
+TEST(BatchStateTest, ignoresALineCutShortByACrash) {
+    const ScratchDirectory scratch("qoi_batchstate_test_crash");
+    const BatchJob first{.d_input = scratch.d_path / "a.ppm",
+                         .d_output = scratch.d_path / "a.qoi"};
+    const BatchJob second{.d_input = scratch.d_path / "b.ppm",
+                          .d_output = scratch.d_path / "b.qoi"};
+    const auto stateFile = scratch.d_path / "state";
+    for (const auto &job : {first, second}) {
+        writeText(job.d_input, job.d_input.string());
+        writeText(job.d_output, job.d_output.string());
+    }
+
+    {
+        BatchState state(stateFile);
+        state.record(first, stampFile(first.d_input), stampFile(first.d_output));
+        state.record(second, stampFile(second.d_input), stampFile(second.d_output));
+    }
+
+    std::filesystem::resize_file(stateFile, std::filesystem::file_size(stateFile) - 30);
+
+    const BatchState state(stateFile);
+    EXPECT_EQ(state.size(), 1u);
+    EXPECT_TRUE(state.isUpToDate(first));
+    EXPECT_FALSE(state.isUpToDate(second));
+}
+
+TEST(BatchStateTest, doesNotSkipAnInputChangedWhileItsJobRan) {
+    const ScratchDirectory scratch("qoi_batchstate_test_changed");
+    const BatchJob job{.d_input = scratch.d_path / "a.ppm", .d_output = scratch.d_path / "a.qoi"};
+    writeText(job.d_input, "input");
+    writeText(job.d_output, "output");
+
+    // the input was stamped when it was read, and changed before its output was written
+    const FileStamp inputStamp = stampFile(job.d_input);
+    writeText(job.d_input, "INPUT");
+    std::filesystem::last_write_time(job.d_input, std::filesystem::last_write_time(job.d_input) +
+                                                      std::chrono::seconds(10));
+
+    BatchState state(scratch.d_path / "state");
+    state.record(job, inputStamp, stampFile(job.d_output));
+    EXPECT_FALSE(state.isUpToDate(job));
+}
+
+TEST(BatchStateTest, keepsPathsWithTabsAndLineBreaksApart) {
+    const ScratchDirectory scratch("qoi_batchstate_test_names");
+    const BatchJob odd{.d_input = scratch.d_path / "a\tb\nc\\.ppm",
+                       .d_output = scratch.d_path / "a\tb\nc\\.qoi"};
+    const BatchJob plain{.d_input = scratch.d_path / "c\\.ppm",
+                         .d_output = scratch.d_path / "c\\.qoi"};
+    for (const BatchJob &job : {odd, plain}) {
+        writeText(job.d_input, "input");
+        writeText(job.d_output, "output");
+    }
+
+    {
+        BatchState state(scratch.d_path / "state");
+        state.record(odd, stampFile(odd.d_input), stampFile(odd.d_output));
+        state.record(plain, stampFile(plain.d_input), stampFile(plain.d_output));
+    }
+
+    // each name comes back whole and on its own, after the journal and after compacting it
+    for (int run = 0; run < 2; ++run) {
+        const BatchState state(scratch.d_path / "state");
+        EXPECT_EQ(state.size(), 2u);
+        EXPECT_TRUE(state.isUpToDate(odd));
+        EXPECT_TRUE(state.isUpToDate(plain));
+    }
+}
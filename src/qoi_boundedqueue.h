@@ -0,0 +1,138 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace qoi {
+// A first-in first-out queue of at most a fixed number of items, shared by the threads of two
+// pipeline stages. Producers block while it is full and consumers while it is empty, so a fast
+// stage cannot run ahead of a slow one by more than the capacity. Once closed, pushes fail and
+// pops drain what is left before reporting the end.
+template <class T>
+class BoundedQueue {
+    // DATA
+    std::mutex d_mutex;
+    std::condition_variable d_notEmpty;
+    std::condition_variable d_notFull;
+    std::deque<T> d_items;
+    std::size_t d_capacity;
+    bool d_closed;
+
+  public:
+    // CREATORS
+
+    // Create an open queue holding at most 'capacity' items (at least 1).
+    explicit BoundedQueue(std::size_t capacity);
+
+    BoundedQueue(const BoundedQueue &) = delete;
+
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    // MANIPULATORS
+
+    // Append 'item', waiting while the queue is full. Return false, dropping 'item', if the queue
+    // is closed.
+    bool push(T item);
+
+    // Append 'item' if the queue is open and not full, and return whether it was appended.
+    bool tryPush(T item);
+
+    // Remove and return the oldest item, waiting while the queue is empty and open. Return
+    // nothing once the queue is closed and empty.
+    std::optional<T> pop();
+
+    // Remove and return the oldest item if there is one.
+    std::optional<T> tryPop();
+
+    // Refuse further items and wake every waiting thread.
+    void close();
+};
+
+// CREATORS
+template <class T>
+BoundedQueue<T>::BoundedQueue(std::size_t capacity)
+    : d_mutex(), d_notEmpty(), d_notFull(), d_items(), d_capacity(capacity > 0 ? capacity : 1),
+      d_closed(false) {}
+
+// MANIPULATORS
+template <class T>
+bool BoundedQueue<T>::push(T item) {
+    {
+        std::unique_lock lock(d_mutex);
+        d_notFull.wait(lock, [this] { return d_closed || d_items.size() < d_capacity; });
+        if (d_closed) {
+            return false;
+        }
+
+        d_items.push_back(std::move(item));
+    }
+
+    d_notEmpty.notify_one();
+    return true;
+}
+
+template <class T>
+bool BoundedQueue<T>::tryPush(T item) {
+    {
+        const std::lock_guard lock(d_mutex);
+        if (d_closed || d_items.size() >= d_capacity) {
+            return false;
+        }
+
+        d_items.push_back(std::move(item));
+    }
+
+    d_notEmpty.notify_one();
+    return true;
+}
+
+template <class T>
+std::optional<T> BoundedQueue<T>::pop() {
+    std::optional<T> item;
+    {
+        std::unique_lock lock(d_mutex);
+        d_notEmpty.wait(lock, [this] { return d_closed || !d_items.empty(); });
+        if (d_items.empty()) {
+            return std::nullopt;
+        }
+
+        item.emplace(std::move(d_items.front()));
+        d_items.pop_front();
+    }
+
+    d_notFull.notify_one();
+    return item;
+}
+
+template <class T>
+std::optional<T> BoundedQueue<T>::tryPop() {
+    std::optional<T> item;
+    {
+        const std::lock_guard lock(d_mutex);
+        if (d_items.empty()) {
+            return std::nullopt;
+        }
+
+        item.emplace(std::move(d_items.front()));
+        d_items.pop_front();
+    }
+
+    d_notFull.notify_one();
+    return item;
+}
+
+template <class T>
+void BoundedQueue<T>::close() {
+    {
+        const std::lock_guard lock(d_mutex);
+        d_closed = true;
+    }
+
+    d_notEmpty.notify_all();
+    d_notFull.notify_all();
+}
+} // namespace qoi
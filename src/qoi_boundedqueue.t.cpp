@@ -0,0 +1,54 @@
+#include <qoi_boundedqueue.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace qoi;
+
+TEST(BoundedQueueTest, refusesItemsBeyondCapacity) {
+    BoundedQueue<int> queue(2);
+    EXPECT_TRUE(queue.tryPush(1));
+    EXPECT_TRUE(queue.tryPush(2));
+    EXPECT_FALSE(queue.tryPush(3));
+
+    EXPECT_EQ(queue.tryPop(), 1);
+    EXPECT_TRUE(queue.tryPush(3));
+    EXPECT_EQ(queue.tryPop(), 2);
+    EXPECT_EQ(queue.tryPop(), 3);
+    EXPECT_EQ(queue.tryPop(), std::nullopt);
+}
+
+TEST(BoundedQueueTest, closeDrainsThenEnds) {
+    BoundedQueue<int> queue(4);
+    queue.push(7);
+    queue.close();
+
+    EXPECT_FALSE(queue.push(8));
+    EXPECT_EQ(queue.pop(), 7);
+    EXPECT_EQ(queue.pop(), std::nullopt);
+}
+
+TEST(BoundedQueueTest, passesEveryItemInOrderBetweenThreads) {
+    BoundedQueue<int> queue(3);
+    std::vector<int> received;
+    {
+        std::jthread consumer([&] {
+            while (const auto item = queue.pop()) {
+                received.push_back(*item);
+            }
+        });
+
+        for (int item = 0; item < 1000; ++item) {
+            queue.push(item);
+        }
+
+        queue.close();
+    }
+
+    ASSERT_EQ(received.size(), 1000u);
+    for (int item = 0; item < 1000; ++item) {
+        EXPECT_EQ(received[item], item);
+    }
+}
@@ -0,0 +1,196 @@
+#include <qoi_chunkdecoder.h>
+
+#include <qoi_constants.h>
+#include <qoi_optable.h>
+#include <qoi_simd.h>
+#include <qoi_utils.h>
+
+#include <algorithm>
+
+namespace qoi {
+auto findChunkBoundaries(std::span<const Byte> ops, std::size_t numPixels, std::size_t numChunks)
+    -> std::vector<ChunkBoundary> {
+    std::vector<ChunkBoundary> boundaries{
+        {.d_byteOffset = 0, .d_pixelOffset = 0, .d_alphaHint = 255}};
+    if (ops.size() < QOI_END_MARKER.size() || numChunks == 0) {
+        return boundaries;
+    }
+
+    const Byte *bytes = ops.data();
+    const auto opsEnd = ops.size() - QOI_END_MARKER.size();
+
+    std::size_t offset = 0;
+    std::size_t pixel = 0;
+    Byte alpha = 255;
+    std::size_t target = numPixels / numChunks;
+
+    while (offset < opsEnd && pixel < numPixels && boundaries.size() < numChunks) {
+        const auto &op = QOI_OP_TABLE[bytes[offset]];
+        if (pixel >= target &&
+            (op.d_kind == OpKind::RGBA || op.d_kind == OpKind::RGB || op.d_kind == OpKind::INDEX)) {
+            boundaries.push_back(
+                {.d_byteOffset = offset, .d_pixelOffset = pixel, .d_alphaHint = alpha});
+            target = boundaries.size() * numPixels / numChunks;
+        }
+
+        if (op.d_kind == OpKind::RGBA) {
+            alpha = bytes[offset + 4];
+        }
+
+        pixel += op.d_kind == OpKind::RUN ? op.d_value : 1;
+        offset += op.d_length;
+    }
+
+    return boundaries;
+}
+
+// CREATORS
+ChunkDecoder::ChunkDecoder()
+    : d_prevPixel(), d_pixelCache(), d_symbolicSpans(), d_assumedHashes(0), d_assumedAlphas(0),
+      d_assumedPrevAlpha(false), d_alphaHint(255),
+      d_stop{.d_byteOffset = 0, .d_pixelOffset = 0, .d_alphaHint = 255} {}
+
+// PRIVATE ACCESSORS
+Pixel ChunkDecoder::valueOf(const SymbolicPixel &pixel, const Pixel &prevPixel,
+                            const PixelCache &pixelCache) const {
+    if (pixel.d_source == SOURCE_KNOWN) {
+        return pixel.d_value;
+    }
+
+    Pixel value = pixel.d_source == SOURCE_PREV ? prevPixel : pixelCache[pixel.d_source];
+    value.d_red += pixel.d_value.d_red;
+    value.d_green += pixel.d_value.d_green;
+    value.d_blue += pixel.d_value.d_blue;
+    return value;
+}
+
+// MANIPULATORS
+template <Channel CHANNELS>
+void ChunkDecoder::decode(std::span<const Byte> ops, const ChunkBoundary &begin,
+                          const ChunkBoundary &end, Byte *output) {
+    // every pixel starts out as the incoming pixel it refers to, unchanged
+    d_prevPixel = {.d_value = {.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 0},
+                   .d_source = SOURCE_PREV};
+    for (std::size_t slot = 0; slot < d_pixelCache.size(); ++slot) {
+        d_pixelCache[slot] = {.d_value = {.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 0},
+                              .d_source = static_cast<std::uint8_t>(slot)};
+    }
+
+    d_symbolicSpans.clear();
+    d_assumedHashes = 0;
+    d_assumedAlphas = 0;
+    d_assumedPrevAlpha = false;
+    d_alphaHint = begin.d_alphaHint;
+
+    const Byte *bytes = ops.data();
+    std::size_t offset = begin.d_byteOffset;
+    std::size_t pixel = begin.d_pixelOffset;
+
+    while (offset < end.d_byteOffset && pixel < end.d_pixelOffset) {
+        const auto &op = QOI_OP_TABLE[bytes[offset]];
+        SymbolicPixel currPixel = d_prevPixel;
+        std::size_t count = 1;
+
+        switch (op.d_kind) {
+        case OpKind::RGBA:
+            currPixel = {.d_value = loadPixel(bytes + offset + 1), .d_source = SOURCE_KNOWN};
+            break;
+        case OpKind::RGB:
+            currPixel.d_value = loadPixel(bytes + offset + 1);
+            if (d_prevPixel.d_source == SOURCE_KNOWN) {
+                currPixel.d_value.d_alpha = d_prevPixel.d_value.d_alpha;
+            } else {
+                // guess the alpha so that the pixel, and the slot it is indexed at, are known
+                currPixel.d_value.d_alpha = d_alphaHint;
+                if (d_prevPixel.d_source == SOURCE_PREV) {
+                    d_assumedPrevAlpha = true;
+                } else {
+                    d_assumedAlphas |= std::uint64_t{1} << d_prevPixel.d_source;
+                }
+            }
+
+            currPixel.d_source = SOURCE_KNOWN;
+            break;
+        case OpKind::INDEX:
+            currPixel = d_pixelCache[op.d_value];
+            break;
+        case OpKind::DIFF:
+        case OpKind::LUMA: {
+            if (d_prevPixel.d_source == SOURCE_PREV) {
+                d_stop = {.d_byteOffset = offset, .d_pixelOffset = pixel, .d_alphaHint = 255};
+                return;
+            }
+
+            const Byte redBlue = op.d_kind == OpKind::LUMA ? bytes[offset + 1] : 0x00;
+            currPixel.d_value.d_red += op.d_dr + (redBlue >> 4);
+            currPixel.d_value.d_green += op.d_dg;
+            currPixel.d_value.d_blue += op.d_db + (redBlue & 0x0F);
+            break;
+        }
+        case OpKind::RUN:
+            count = std::min<std::size_t>(op.d_value, end.d_pixelOffset - pixel);
+            break;
+        }
+
+        if (currPixel.d_source == SOURCE_KNOWN) {
+            fillRun<CHANNELS>(output + pixel * CHANNELS, count, currPixel.d_value);
+            d_pixelCache[hashIndex(currPixel.d_value)] = currPixel;
+        } else {
+            d_symbolicSpans.push_back(
+                {.d_firstPixel = pixel, .d_numPixels = count, .d_pixel = currPixel});
+
+            // the hash is linear in the channels, so a delta on top of a slot moves the slot by
+            // the hash of the delta; the incoming previous pixel is already at its own slot
+            if (currPixel.d_source != SOURCE_PREV) {
+                d_assumedHashes |= std::uint64_t{1} << currPixel.d_source;
+                d_pixelCache[(currPixel.d_source + hashIndex(currPixel.d_value)) % 64] = currPixel;
+            }
+        }
+
+        d_prevPixel = currPixel;
+        pixel += count;
+        offset += op.d_length;
+    }
+
+    d_stop = {.d_byteOffset = offset, .d_pixelOffset = pixel, .d_alphaHint = 255};
+}
+
+// ACCESSORS
+template <Channel CHANNELS>
+bool ChunkDecoder::resolve(Pixel &prevPixel, PixelCache &pixelCache, Byte *output) const {
+    if (d_assumedPrevAlpha && prevPixel.d_alpha != d_alphaHint) {
+        return false;
+    }
+
+    for (std::size_t slot = 0; slot < pixelCache.size(); ++slot) {
+        const auto bit = std::uint64_t{1} << slot;
+        if (((d_assumedHashes & bit) && hashIndex(pixelCache[slot]) != slot) ||
+            ((d_assumedAlphas & bit) && pixelCache[slot].d_alpha != d_alphaHint)) {
+            return false;
+        }
+    }
+
+    for (const auto &span : d_symbolicSpans) {
+        fillRun<CHANNELS>(output + span.d_firstPixel * CHANNELS, span.d_numPixels,
+                          valueOf(span.d_pixel, prevPixel, pixelCache));
+    }
+
+    PixelCache outgoingCache;
+    for (std::size_t slot = 0; slot < outgoingCache.size(); ++slot) {
+        outgoingCache[slot] = valueOf(d_pixelCache[slot], prevPixel, pixelCache);
+    }
+
+    prevPixel = valueOf(d_prevPixel, prevPixel, pixelCache);
+    pixelCache = outgoingCache;
+    return true;
+}
+
+const ChunkBoundary &ChunkDecoder::stop() const { return d_stop; }
+
+template void ChunkDecoder::decode<3>(std::span<const Byte>, const ChunkBoundary &,
+                                      const ChunkBoundary &, Byte *);
+template void ChunkDecoder::decode<4>(std::span<const Byte>, const ChunkBoundary &,
+                                      const ChunkBoundary &, Byte *);
+template bool ChunkDecoder::resolve<3>(Pixel &, PixelCache &, Byte *) const;
+template bool ChunkDecoder::resolve<4>(Pixel &, PixelCache &, Byte *) const;
+} // namespace qoi
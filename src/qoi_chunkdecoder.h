@@ -0,0 +1,98 @@
+#pragma once
+
+#include <qoi_types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace qoi {
+// A position in a QOI op stream: the byte offset of an op and the index of the first pixel it
+// produces.
+struct ChunkBoundary {
+    std::size_t d_byteOffset;
+    std::size_t d_pixelOffset;
+    Byte d_alphaHint; // alpha of the last QOI_OP_RGBA before this point, 255 if there is none
+};
+
+// Split the op stream 'ops' (everything after the header, end marker included) of an image of
+// 'numPixels' pixels into at most 'numChunks' chunks of roughly equal pixel counts, walking only
+// the op lengths. The first boundary is always the start of the stream. Later chunks start at a
+// QOI_OP_RGBA, QOI_OP_RGB or QOI_OP_INDEX where possible, since those depend least on the
+// preceding pixels.
+auto findChunkBoundaries(std::span<const Byte> ops, std::size_t numPixels, std::size_t numChunks)
+    -> std::vector<ChunkBoundary>;
+
+// Decodes one chunk of a QOI op stream without knowing the previous pixel and index it starts
+// from. Pixels derived from that incoming state are recorded as a reference to the incoming
+// previous pixel or index slot plus a colour delta, and 'resolve' fills them in once the state is
+// known. The index slot of such a pixel follows from the hash being linear in the channels. Two
+// guesses keep the chunk going where the state matters: an incoming index slot holds a pixel
+// that hashes to that slot, and a QOI_OP_RGB on top of an unknown pixel keeps the hinted alpha.
+// 'resolve' checks both against the real state. Decoding stops early at a QOI_OP_DIFF or
+// QOI_OP_LUMA applied to the unknown previous pixel itself, whose index slot cannot be derived.
+class ChunkDecoder {
+    // TYPES
+    struct SymbolicPixel {
+        Pixel d_value;         // the pixel, or the colour delta on top of its source (alpha 0)
+        std::uint8_t d_source; // SOURCE_KNOWN, SOURCE_PREV or the incoming index slot
+    };
+
+    struct SymbolicSpan {
+        std::size_t d_firstPixel;
+        std::size_t d_numPixels;
+        SymbolicPixel d_pixel;
+    };
+
+    static constexpr std::uint8_t SOURCE_PREV = 64;
+    static constexpr std::uint8_t SOURCE_KNOWN = 65;
+
+    // DATA
+    SymbolicPixel d_prevPixel;
+    std::array<SymbolicPixel, 64> d_pixelCache;
+    std::vector<SymbolicSpan> d_symbolicSpans;
+    std::uint64_t d_assumedHashes; // incoming slots assumed to hold a pixel hashing to the slot
+    std::uint64_t d_assumedAlphas; // incoming slots assumed to hold the hinted alpha
+    bool d_assumedPrevAlpha;       // incoming previous pixel assumed to have the hinted alpha
+    Byte d_alphaHint;
+    ChunkBoundary d_stop;
+
+    // PRIVATE ACCESSORS
+    Pixel valueOf(const SymbolicPixel &pixel, const Pixel &prevPixel,
+                  const PixelCache &pixelCache) const;
+
+  public:
+    // CREATORS
+    ChunkDecoder();
+
+    // MANIPULATORS
+
+    // Decode the ops from 'begin' up to 'end' of 'ops' into 'output', which holds the whole image
+    // as interleaved pixels of 'CHANNELS' bytes. Pixels that depend on the incoming state are left
+    // for 'resolve'.
+    template <Channel CHANNELS>
+    void decode(std::span<const Byte> ops, const ChunkBoundary &begin, const ChunkBoundary &end,
+                Byte *output);
+
+    // ACCESSORS
+
+    // Given the actual state 'prevPixel' and 'pixelCache' the chunk starts from, write the pending
+    // pixels to 'output' and replace the state with the one at 'stop()', then return true. Return
+    // false, leaving everything untouched, if a guess about the incoming state was wrong; the
+    // chunk must then be decoded again from its start.
+    template <Channel CHANNELS>
+    bool resolve(Pixel &prevPixel, PixelCache &pixelCache, Byte *output) const;
+
+    // Return where decoding stopped, which is 'end' unless it stopped early.
+    const ChunkBoundary &stop() const;
+};
+
+extern template void ChunkDecoder::decode<3>(std::span<const Byte>, const ChunkBoundary &,
+                                             const ChunkBoundary &, Byte *);
+extern template void ChunkDecoder::decode<4>(std::span<const Byte>, const ChunkBoundary &,
+                                             const ChunkBoundary &, Byte *);
+extern template bool ChunkDecoder::resolve<3>(Pixel &, PixelCache &, Byte *) const;
+extern template bool ChunkDecoder::resolve<4>(Pixel &, PixelCache &, Byte *) const;
+} // namespace qoi
@@ -0,0 +1,70 @@
+#include <qoi_chunkdecoder.h>
+#include <qoi_constants.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace qoi;
+
+TEST(ChunkDecoderTest, boundariesStartAtSelfContainedOps) {
+    // clang-format off
+    const std::vector<Byte> ops = {
+        QOI_OP_RGBA, 1, 2, 3, 200, // pixel 0
+        QOI_OP_RUN | 2,            // pixels 1-3
+        QOI_OP_DIFF | 0x3F,        // pixel 4
+        QOI_OP_RGB, 4, 5, 6,       // pixel 5
+        QOI_OP_INDEX | 7,          // pixel 6
+        QOI_OP_RUN | 0,            // pixel 7
+        0, 0, 0, 0, 0, 0, 0, 1};
+    // clang-format on
+
+    const auto boundaries = findChunkBoundaries(ops, 8, 2);
+
+    // the midpoint falls on the run and the diff, so the chunk starts at the next QOI_OP_RGB
+    ASSERT_EQ(boundaries.size(), 2);
+    EXPECT_EQ(boundaries[1].d_byteOffset, 7);
+    EXPECT_EQ(boundaries[1].d_pixelOffset, 5);
+    EXPECT_EQ(boundaries[1].d_alphaHint, 200);
+}
+
+TEST(ChunkDecoderTest, resolvesPixelsFromIncomingState) {
+    const Pixel known{.d_red = 50, .d_green = 60, .d_blue = 70, .d_alpha = 255};
+    const auto slot = hashIndex(known);
+    // clang-format off
+    const std::vector<Byte> ops = {
+        static_cast<Byte>(QOI_OP_INDEX | slot), // the incoming pixel at 'slot'
+        QOI_OP_DIFF | 0x3F,                     // +1 on every channel
+        QOI_OP_RUN | 1,                         // two more copies
+        0, 0, 0, 0, 0, 0, 0, 1};
+    // clang-format on
+    const ChunkBoundary begin{.d_byteOffset = 0, .d_pixelOffset = 0, .d_alphaHint = 255};
+    const ChunkBoundary end{.d_byteOffset = 3, .d_pixelOffset = 4, .d_alphaHint = 255};
+
+    ChunkDecoder decoder;
+    std::vector<Byte> output(4 * 4);
+    decoder.decode<4>(ops, begin, end, output.data());
+    EXPECT_EQ(decoder.stop().d_pixelOffset, 4);
+
+    // a slot holding a pixel that does not hash to it breaks the guess
+    PixelCache wrongCache{};
+    wrongCache[slot] = {.d_red = 1, .d_green = 1, .d_blue = 1, .d_alpha = 1};
+    Pixel prevPixel{.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255};
+    EXPECT_FALSE(decoder.resolve<4>(prevPixel, wrongCache, output.data()));
+
+    PixelCache pixelCache{};
+    pixelCache[slot] = known;
+    ASSERT_TRUE(decoder.resolve<4>(prevPixel, pixelCache, output.data()));
+
+    const Pixel next{.d_red = 51, .d_green = 61, .d_blue = 71, .d_alpha = 255};
+    EXPECT_EQ(loadPixel(output.data()), known);
+    for (std::size_t pixel = 1; pixel < 4; ++pixel) {
+        EXPECT_EQ(loadPixel(output.data() + pixel * 4), next);
+    }
+
+    EXPECT_EQ(prevPixel, next);
+    EXPECT_EQ(pixelCache[slot], known);
+    EXPECT_EQ(pixelCache[hashIndex(next)], next);
+}
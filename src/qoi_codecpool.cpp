@@ -0,0 +1,15 @@
+#include <qoi_codecpool.h>
+
+namespace qoi {
+auto threadEncoder() -> Encoder & {
+    thread_local Encoder encoder;
+    encoder.reset();
+    return encoder;
+}
+
+auto threadDecoder() -> Decoder & {
+    thread_local Decoder decoder;
+    decoder.reset();
+    return decoder;
+}
+} // namespace qoi
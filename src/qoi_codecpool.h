@@ -0,0 +1,15 @@
+#pragma once
+
+#include <qoi_decoder.h>
+#include <qoi_encoder.h>
+
+namespace qoi {
+// Return the encoder owned by the calling thread, reset for a new image. The encoder lives as
+// long as the thread, so a worker that encodes many images grows its buffers once and then
+// encodes without allocating.
+auto threadEncoder() -> Encoder &;
+
+// Return the decoder owned by the calling thread, reset for a new image. Like 'threadEncoder',
+// its buffers are reused by every image the thread decodes.
+auto threadDecoder() -> Decoder &;
+} // namespace qoi
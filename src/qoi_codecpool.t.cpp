@@ -0,0 +1,70 @@
+#include <qoi_codecpool.h>
+#include <qoi_constants.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+// Few distinct values, so that the pixels of one image are found in the index of another.
+auto makeNoise(Width width, Height height, Channel channels, unsigned int seed) -> FileOutput {
+    std::mt19937 generator(seed);
+    std::vector<Byte> bytes(static_cast<std::size_t>(width) * height * channels);
+    for (auto &byte : bytes) {
+        byte = static_cast<Byte>(generator() % 8);
+    }
+
+    return makeFileOutput(width, height, channels, 0, std::move(bytes));
+}
+
+auto opsOf(const EncodedOutput &encoded, const FileOutput &image) -> FileOutput {
+    return makeFileOutput(
+        image.d_width, image.d_height, image.d_channels, 0,
+        std::vector<Byte>(encoded.d_bytes.begin() + QOI_HEADER_SIZE, encoded.d_bytes.end()));
+}
+} // namespace
+
+TEST(CodecPoolTest, reusesOneCodecPerThread) {
+    Encoder *encoder = &threadEncoder();
+    Decoder *decoder = &threadDecoder();
+    EXPECT_EQ(&threadEncoder(), encoder);
+    EXPECT_EQ(&threadDecoder(), decoder);
+
+    // compared while the other thread runs, since its codecs may take the same address once it
+    // has exited
+    bool isOwnCodec = false;
+    std::jthread([&] {
+        isOwnCodec = &threadEncoder() != encoder && &threadDecoder() != decoder;
+    }).join();
+    EXPECT_TRUE(isOwnCodec);
+}
+
+TEST(CodecPoolTest, resetsTheCodecsBetweenImages) {
+    const FileOutput first = makeNoise(31, 17, 4, 1);
+    const FileOutput second = makeNoise(23, 19, 3, 2);
+
+    // the second image would come out differently if the last pixel or the index of the first
+    // were left over
+    const EncodedOutput firstEncoded = threadEncoder().encodeToQOI(first);
+    const EncodedOutput secondEncoded = threadEncoder().encodeToQOI(second);
+    EXPECT_EQ(firstEncoded.d_bytes, Encoder().encodeToQOI(first).d_bytes);
+    EXPECT_EQ(secondEncoded.d_bytes, Encoder().encodeToQOI(second).d_bytes);
+
+    const FileOutput firstOps = opsOf(firstEncoded, first);
+    const FileOutput secondOps = opsOf(secondEncoded, second);
+    const FileOutput firstDecoded = threadDecoder().decodeQOIToBytes(firstOps, 4);
+    const FileOutput secondDecoded = threadDecoder().decodeQOIToBytes(secondOps, 3);
+    EXPECT_TRUE(std::ranges::equal(firstDecoded.d_bytes,
+                                   Decoder().decodeQOIToBytes(firstOps, 4).d_bytes));
+    EXPECT_TRUE(std::ranges::equal(secondDecoded.d_bytes,
+                                   Decoder().decodeQOIToBytes(secondOps, 3).d_bytes));
+    EXPECT_TRUE(std::ranges::equal(secondDecoded.d_bytes, second.d_bytes));
+}
@@ -28,6 +28,8 @@ constexpr std::uint32_t PPM_MAX_PIXEL_VALUE = 255;
 // CLI INFO
 constexpr std::string DECODE_OP = "decode";
 constexpr std::string ENCODE_OP = "encode";
+constexpr std::string INFO_OP = "info";
+constexpr std::string BATCH_OP = "batch";
 constexpr std::string PPM_FILE_FORMAT = "ppm";
 constexpr std::string PNG_FILE_FORMAT = "png";
 } // namespace qoi
@@ -0,0 +1,114 @@
+#include <qoi_cpu.h>
+
+#include <qoi_simd.h>
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+namespace qoi {
+namespace {
+constexpr std::array<std::string_view, 5> ISA_LEVEL_NAMES = {"scalar", "sse2", "ssse3", "avx2",
+                                                             "avx512"};
+
+// The level picked at startup, and why the QOI_ISA environment variable was ignored if it was.
+struct InitialIsaLevel {
+    IsaLevel d_level;
+    std::string d_rejectedOverride;
+};
+
+auto pickInitialIsaLevel() -> InitialIsaLevel {
+    const IsaLevel detected = detectIsaLevel();
+
+    const char *override = std::getenv("QOI_ISA");
+    if (override == nullptr) {
+        return {.d_level = detected, .d_rejectedOverride = {}};
+    }
+
+    // an override that is unknown or that the CPU cannot run is ignored rather than failing every
+    // codec call, and kept for the program to report, so a benchmark cannot silently measure
+    // another level
+    std::string reason;
+    try {
+        const IsaLevel level = parseIsaLevel(override);
+        if (level <= detected) {
+            return {.d_level = level, .d_rejectedOverride = {}};
+        }
+
+        reason = "the CPU does not support it, using " + std::string(isaLevelName(detected));
+    } catch (const std::exception &e) {
+        reason = e.what();
+    }
+
+    return {.d_level = detected,
+            .d_rejectedOverride = "Ignoring QOI_ISA=" + std::string(override) + ": " + reason};
+}
+
+auto initialIsaLevel() -> const InitialIsaLevel & {
+    static const InitialIsaLevel initial = pickInitialIsaLevel();
+    return initial;
+}
+
+auto activeLevel() -> std::atomic<IsaLevel> & {
+    static std::atomic<IsaLevel> level{initialIsaLevel().d_level};
+    return level;
+}
+} // namespace
+
+auto detectIsaLevel() -> IsaLevel {
+#if defined(QOI_HAVE_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+        return IsaLevel::AVX512;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+        return IsaLevel::AVX2;
+    }
+
+    if (__builtin_cpu_supports("ssse3")) {
+        return IsaLevel::SSSE3;
+    }
+
+    if (__builtin_cpu_supports("sse2")) {
+        return IsaLevel::SSE2;
+    }
+#endif
+
+    return IsaLevel::SCALAR;
+}
+
+auto activeIsaLevel() -> IsaLevel { return activeLevel().load(std::memory_order_relaxed); }
+
+void setIsaLevel(IsaLevel level) {
+    if (level > detectIsaLevel()) {
+        throw std::runtime_error("The CPU does not support " + std::string(isaLevelName(level)));
+    }
+
+    activeLevel().store(level, std::memory_order_relaxed);
+    selectKernels(level);
+}
+
+auto rejectedIsaOverride() -> const std::string & { return initialIsaLevel().d_rejectedOverride; }
+
+auto isaLevelName(IsaLevel level) -> std::string_view {
+    return ISA_LEVEL_NAMES[static_cast<std::size_t>(level)];
+}
+
+auto parseIsaLevel(std::string_view name) -> IsaLevel {
+    if (name == "auto") {
+        return detectIsaLevel();
+    }
+
+    for (std::size_t level = 0; level < ISA_LEVEL_NAMES.size(); ++level) {
+        if (ISA_LEVEL_NAMES[level] == name) {
+            return static_cast<IsaLevel>(level);
+        }
+    }
+
+    throw std::runtime_error("Unknown instruction set: " + std::string(name) +
+                             ". Supported: auto, scalar, sse2, ssse3, avx2, avx512");
+}
+} // namespace qoi
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// x86 kernels are compiled for several instruction sets with per-function target attributes and
+// picked at run time, so one binary runs everywhere and still uses the widest unit available.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define QOI_HAVE_X86_DISPATCH 1
+#endif
+
+namespace qoi {
+// Instruction set levels the SIMD kernels are built for, each one including the levels before it.
+enum class IsaLevel : std::uint8_t { SCALAR, SSE2, SSSE3, AVX2, AVX512 };
+
+// Return the highest level supported by the CPU the program runs on.
+auto detectIsaLevel() -> IsaLevel;
+
+// Return the level the kernels currently dispatch to. It starts out as the detected level, or the
+// one named by the QOI_ISA environment variable when the CPU supports it; any other QOI_ISA value
+// is ignored.
+auto activeIsaLevel() -> IsaLevel;
+
+// Return why the QOI_ISA environment variable was ignored at startup, e.g. "Ignoring
+// QOI_ISA=avx512: the CPU does not support it, using avx2", or an empty string if it was used or
+// not set. The library prints nothing, so the program decides how to report it.
+auto rejectedIsaOverride() -> const std::string &;
+
+// Dispatch every kernel to its variant for 'level' from now on, so that each path can be tested
+// and benchmarked on one machine. Throws if the CPU does not support 'level'. Must not be called
+// while other threads are encoding or decoding.
+void setIsaLevel(IsaLevel level);
+
+// Return the name of 'level' as accepted by 'parseIsaLevel', e.g. "avx2".
+auto isaLevelName(IsaLevel level) -> std::string_view;
+
+// Return the level named 'name' ("scalar", "sse2", "ssse3", "avx2" or "avx512"), or the detected
+// level for "auto". Throws if the name is unknown.
+auto parseIsaLevel(std::string_view name) -> IsaLevel;
+} // namespace qoi
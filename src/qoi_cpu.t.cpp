@@ -0,0 +1,31 @@
+#include <qoi_cpu.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+using namespace qoi;
+
+TEST(IsaLevelTest, namesRoundTrip) {
+    for (IsaLevel level :
+         {IsaLevel::SCALAR, IsaLevel::SSE2, IsaLevel::SSSE3, IsaLevel::AVX2, IsaLevel::AVX512}) {
+        EXPECT_EQ(parseIsaLevel(isaLevelName(level)), level);
+    }
+
+    EXPECT_EQ(parseIsaLevel("auto"), detectIsaLevel());
+    EXPECT_THROW(parseIsaLevel("neon"), std::runtime_error);
+}
+
+TEST(IsaLevelTest, overridesActiveLevel) {
+    const IsaLevel active = activeIsaLevel();
+
+    setIsaLevel(IsaLevel::SCALAR);
+    EXPECT_EQ(activeIsaLevel(), IsaLevel::SCALAR);
+
+    if (detectIsaLevel() != IsaLevel::AVX512) {
+        EXPECT_THROW(setIsaLevel(IsaLevel::AVX512), std::runtime_error);
+    }
+
+    setIsaLevel(active);
+    EXPECT_EQ(activeIsaLevel(), active);
+}
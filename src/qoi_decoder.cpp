@@ -1,44 +1,174 @@
 #include <qoi_decoder.h>
 
+#include <qoi_chunkdecoder.h>
 #include <qoi_constants.h>
+#include <qoi_optable.h>
+#include <qoi_simd.h>
 #include <qoi_utils.h>
 
+#include <algorithm>
+#include <cstring>
 #include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
 
 namespace qoi {
+namespace {
+// Chunks smaller than this cost more to hand to a thread than they take to decode.
+constexpr std::size_t MIN_CHUNK_PIXELS = 1 << 16;
+} // namespace
+
+auto pixelCount(const FileOutput &fileData) -> std::size_t {
+    // a single op produces at most 62 pixels, anything larger cannot be a valid stream
+    const auto numPixels =
+        static_cast<std::size_t>(fileData.d_width) * static_cast<std::size_t>(fileData.d_height);
+    if (fileData.d_bytes.size() < QOI_END_MARKER.size() ||
+        numPixels > fileData.d_bytes.size() * 62) {
+        throw std::runtime_error("QOI file is corrupted or incomplete");
+    }
+
+    return numPixels;
+}
+
 // CREATOR
 Decoder::Decoder(Offset offset)
-    : d_prevPixel{.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255}, d_pixelCache(64),
-      d_outputBuffer(), d_offset(offset) {
-    d_outputBuffer.reserve(500000);
-}
+    : d_prevPixel{.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255}, d_pixelCache(),
+      d_outputBuffer(), d_offset(offset), d_initialOffset(offset) {}
 
-// MANIPULATOR
-DecodedOutput Decoder::decodeQOI(const FileOutput &fileData) {
-    while (d_offset < fileData.d_bytes.size() - 8) {
-        Pixel currPixel;
-        if (fileData.d_bytes[d_offset] == QOI_OP_RGBA) {
-            processRGBAOp(fileData.d_bytes, currPixel);
-        } else if (fileData.d_bytes[d_offset] == QOI_OP_RGB) {
-            processRGBOp(fileData.d_bytes, currPixel);
-        } else if ((fileData.d_bytes[d_offset] >> 6) == (QOI_OP_INDEX >> 6)) {
-            processIndexOp(fileData.d_bytes, currPixel);
-        } else if ((fileData.d_bytes[d_offset] >> 6) == (QOI_OP_DIFF >> 6)) {
-            processDiffOp(fileData.d_bytes, currPixel);
-        } else if ((fileData.d_bytes[d_offset] >> 6) == (QOI_OP_LUMA >> 6)) {
-            processLumaOp(fileData.d_bytes, currPixel);
-        } else if ((fileData.d_bytes[d_offset] >> 6) == (QOI_OP_RUN >> 6)) {
-            processRunOp(fileData.d_bytes, currPixel);
-        } else {
-            throw std::runtime_error("Corrupted byte, qoi operation does not exist for this byte");
+// PRIVATE MANIPULATORS
+template <Channel CHANNELS>
+void Decoder::decodePixels(const FileOutput &fileData, Byte *output, std::size_t numPixels) {
+    const Byte *bytes = fileData.d_bytes.data();
+    const auto opsEnd = fileData.d_bytes.size() - QOI_END_MARKER.size();
+
+    Byte *cursor = output;
+    Byte *const outputEnd = output + numPixels * CHANNELS;
+
+    while (d_offset < opsEnd && cursor != outputEnd) {
+        const auto &op = QOI_OP_TABLE[bytes[d_offset]];
+        Pixel currPixel = d_prevPixel;
+
+        switch (op.d_kind) {
+        case OpKind::RGBA:
+            currPixel = loadPixel(bytes + d_offset + 1);
+            break;
+        case OpKind::RGB:
+            // the end marker guarantees a fourth byte to load, its value is replaced below
+            currPixel = loadPixel(bytes + d_offset + 1);
+            currPixel.d_alpha = d_prevPixel.d_alpha;
+            break;
+        case OpKind::INDEX:
+            currPixel = d_pixelCache[op.d_value];
+            break;
+        case OpKind::DIFF:
+            currPixel.d_red += op.d_dr;
+            currPixel.d_green += op.d_dg;
+            currPixel.d_blue += op.d_db;
+            break;
+        case OpKind::LUMA: {
+            const Byte redBlue = bytes[d_offset + 1];
+            currPixel.d_red += op.d_dr + (redBlue >> 4);
+            currPixel.d_green += op.d_dg;
+            currPixel.d_blue += op.d_db + (redBlue & 0x0F);
+            break;
+        }
+        case OpKind::RUN: {
+            // the last pixel of the run is written below like any other op
+            const auto runLength =
+                std::min<std::size_t>(op.d_value, (outputEnd - cursor) / CHANNELS);
+            cursor = fillRun<CHANNELS>(cursor, runLength - 1, currPixel);
+            break;
+        }
         }
 
+        std::memcpy(cursor, &currPixel, CHANNELS);
+        cursor += CHANNELS;
+        d_offset += op.d_length;
+
         d_pixelCache[hashIndex(currPixel)] = currPixel;
         d_prevPixel = currPixel;
     }
 
-    // Return pixels
+    if (cursor != outputEnd) {
+        throw std::runtime_error("QOI file is corrupted or incomplete");
+    }
+}
+
+template <Channel CHANNELS>
+void Decoder::decodeChunks(const FileOutput &fileData, Byte *output, std::size_t numChunks) {
+    const auto numPixels =
+        static_cast<std::size_t>(fileData.d_width) * static_cast<std::size_t>(fileData.d_height);
+
+    // phase one: chunk boundaries at op starts, found from the op lengths alone
+    auto boundaries = findChunkBoundaries(fileData.d_bytes.subspan(d_offset), numPixels, numChunks);
+    for (auto &boundary : boundaries) {
+        boundary.d_byteOffset += d_offset;
+    }
+
+    const auto numBoundaries = boundaries.size();
+    boundaries.push_back({.d_byteOffset = fileData.d_bytes.size() - QOI_END_MARKER.size(),
+                          .d_pixelOffset = numPixels,
+                          .d_alphaHint = 255});
+
+    // decode from 'begin' to 'end' the usual way, continuing from 'prevPixel' and 'pixelCache'
+    auto decodeSequentially = [&](const ChunkBoundary &begin, const ChunkBoundary &end,
+                                  Pixel &prevPixel, PixelCache &pixelCache) {
+        Decoder decoder(begin.d_byteOffset);
+        decoder.d_prevPixel = prevPixel;
+        decoder.d_pixelCache = pixelCache;
+        decoder.decodePixels<CHANNELS>(fileData, output + begin.d_pixelOffset * CHANNELS,
+                                       end.d_pixelOffset - begin.d_pixelOffset);
+        prevPixel = decoder.d_prevPixel;
+        pixelCache = decoder.d_pixelCache;
+    };
+
+    // phase two: the first chunk starts from the standard initial state and is decoded for real,
+    // the others concurrently without knowing theirs
+    std::vector<ChunkDecoder> chunkDecoders(numBoundaries);
+    Pixel prevPixel = d_prevPixel;
+    PixelCache pixelCache = d_pixelCache;
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t chunk = 1; chunk < numBoundaries; ++chunk) {
+            workers.emplace_back([&, chunk] {
+                chunkDecoders[chunk].decode<CHANNELS>(fileData.d_bytes, boundaries[chunk],
+                                                      boundaries[chunk + 1], output);
+            });
+        }
+
+        decodeSequentially(boundaries[0], boundaries[1], prevPixel, pixelCache);
+    }
+
+    // fix-up: hand each chunk the state the previous one ended in
+    for (std::size_t chunk = 1; chunk < numBoundaries; ++chunk) {
+        const auto &decoded = chunkDecoders[chunk];
+        if (!decoded.resolve<CHANNELS>(prevPixel, pixelCache, output)) {
+            decodeSequentially(boundaries[chunk], boundaries[chunk + 1], prevPixel, pixelCache);
+        } else if (decoded.stop().d_pixelOffset != boundaries[chunk + 1].d_pixelOffset) {
+            decodeSequentially(decoded.stop(), boundaries[chunk + 1], prevPixel, pixelCache);
+        }
+    }
+}
+
+void Decoder::decodeToBuffer(const FileOutput &fileData) {
+    reset();
+    d_outputBuffer.resize(pixelCount(fileData));
 
+    // a Pixel is laid out exactly like one interleaved 4-channel pixel
+    decodePixels<4>(fileData, reinterpret_cast<Byte *>(d_outputBuffer.data()),
+                    d_outputBuffer.size());
+}
+
+// MANIPULATOR
+void Decoder::reset() {
+    d_prevPixel = {.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255};
+    d_pixelCache.fill(Pixel{});
+    d_offset = d_initialOffset;
+}
+
+DecodedOutput Decoder::decodeQOI(const FileOutput &fileData) & {
+    decodeToBuffer(fileData);
     return {.d_width = fileData.d_width,
             .d_height = fileData.d_height,
             .d_channels = fileData.d_channels,
@@ -46,68 +176,90 @@ DecodedOutput Decoder::decodeQOI(const FileOutput &fileData) {
             .d_pixels = d_outputBuffer};
 }
 
-void Decoder::processRGBAOp(const Bytes &bytes, Pixel &pixel) {
-    ++d_offset;
-    pixel.d_red = bytes[d_offset++];
-    pixel.d_green = bytes[d_offset++];
-    pixel.d_blue = bytes[d_offset++];
-    pixel.d_alpha = bytes[d_offset++];
-    d_outputBuffer.emplace_back(pixel);
+DecodedOutput Decoder::decodeQOI(const FileOutput &fileData) && {
+    decodeToBuffer(fileData);
+    return {.d_width = fileData.d_width,
+            .d_height = fileData.d_height,
+            .d_channels = fileData.d_channels,
+            .d_colorspace = fileData.d_colorspace,
+            .d_pixels = std::move(d_outputBuffer)};
 }
 
-void Decoder::processRGBOp(const Bytes &bytes, Pixel &pixel) {
-    ++d_offset;
-    pixel.d_red = bytes[d_offset++];
-    pixel.d_green = bytes[d_offset++];
-    pixel.d_blue = bytes[d_offset++];
-    pixel.d_alpha = d_prevPixel.d_alpha;
-    d_outputBuffer.emplace_back(pixel);
-}
+std::size_t Decoder::decodeQOI(const FileOutput &fileData, std::span<Pixel> output) {
+    const auto numPixels = pixelCount(fileData);
+    if (output.size() < numPixels) {
+        throw std::runtime_error("The output buffer is smaller than the image");
+    }
 
-void Decoder::processDiffOp(const Bytes &bytes, Pixel &pixel) {
-    constexpr Byte DIFF_MASK = 0x03;
-    int8_t dr = ((bytes[d_offset] >> 4) & DIFF_MASK) - 2;
-    int8_t dg = ((bytes[d_offset] >> 2) & DIFF_MASK) - 2;
-    int8_t db = (bytes[d_offset] & DIFF_MASK) - 2;
-
-    pixel.d_red = d_prevPixel.d_red + dr;
-    pixel.d_green = d_prevPixel.d_green + dg;
-    pixel.d_blue = d_prevPixel.d_blue + db;
-    pixel.d_alpha = d_prevPixel.d_alpha;
-    d_outputBuffer.emplace_back(pixel);
-    ++d_offset;
+    reset();
+    decodePixels<4>(fileData, reinterpret_cast<Byte *>(output.data()), numPixels);
+    return numPixels;
 }
 
-void Decoder::processLumaOp(const Bytes &bytes, Pixel &pixel) {
-    constexpr Byte GREEN_DIFF_MASK = 0x3F;
-    constexpr Byte RED_BLUE_DIFF_MASK = 0x0F;
-    int8_t dg = (bytes[d_offset] & GREEN_DIFF_MASK) - 32;
-    ++d_offset;
-    int8_t dr_dg = ((bytes[d_offset] >> 4) & RED_BLUE_DIFF_MASK) - 8;
-    int8_t db_dg = (bytes[d_offset] & RED_BLUE_DIFF_MASK) - 8;
-    pixel.d_red = d_prevPixel.d_red + dr_dg + dg;
-    pixel.d_green = d_prevPixel.d_green + dg;
-    pixel.d_blue = d_prevPixel.d_blue + db_dg + dg;
-    pixel.d_alpha = d_prevPixel.d_alpha;
-    d_outputBuffer.emplace_back(pixel);
-    ++d_offset;
+FileOutput Decoder::decodeQOIToBytes(const FileOutput &fileData, Channel channels) {
+    if (channels != 3 && channels != 4) {
+        throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
+    }
+
+    reset();
+    const auto numPixels = pixelCount(fileData);
+    std::vector<Byte> bytes(numPixels * channels);
+    if (channels == 4) {
+        decodePixels<4>(fileData, bytes.data(), numPixels);
+    } else {
+        decodePixels<3>(fileData, bytes.data(), numPixels);
+    }
+
+    return makeFileOutput(fileData.d_width, fileData.d_height, channels, fileData.d_colorspace,
+                          std::move(bytes));
 }
 
-void Decoder::processIndexOp(const Bytes &bytes, Pixel &pixel) {
-    auto index = static_cast<std::uint32_t>(bytes[d_offset]);
-    pixel = d_pixelCache[index];
-    d_outputBuffer.emplace_back(pixel);
-    ++d_offset;
+std::size_t Decoder::decodeQOIToBytes(const FileOutput &fileData, Channel channels,
+                                      std::span<Byte> output) {
+    if (channels != 3 && channels != 4) {
+        throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
+    }
+
+    const auto numPixels = pixelCount(fileData);
+    if (output.size() < numPixels * channels) {
+        throw std::runtime_error("The output buffer is smaller than the image");
+    }
+
+    reset();
+    if (channels == 4) {
+        decodePixels<4>(fileData, output.data(), numPixels);
+    } else {
+        decodePixels<3>(fileData, output.data(), numPixels);
+    }
+
+    return numPixels * channels;
 }
 
-void Decoder::processRunOp(const Bytes &bytes, Pixel &pixel) {
-    constexpr Byte RUN_MASK = 0x3F;
-    int8_t runLength = bytes[d_offset] & RUN_MASK;
-    pixel = d_prevPixel;
-    while (runLength >= 0) {
-        d_outputBuffer.emplace_back(pixel);
-        --runLength;
+FileOutput Decoder::decodeQOIToBytes(const FileOutput &fileData, Channel channels,
+                                     unsigned int numThreads) {
+    if (channels != 3 && channels != 4) {
+        throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
     }
-    ++d_offset;
+
+    if (numThreads == 0) {
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    const auto numPixels = pixelCount(fileData);
+    const auto numChunks = std::clamp<std::size_t>(numPixels / MIN_CHUNK_PIXELS, 1, numThreads);
+    if (numChunks == 1) {
+        return decodeQOIToBytes(fileData, channels);
+    }
+
+    reset();
+    std::vector<Byte> bytes(numPixels * channels);
+    if (channels == 4) {
+        decodeChunks<4>(fileData, bytes.data(), numChunks);
+    } else {
+        decodeChunks<3>(fileData, bytes.data(), numChunks);
+    }
+
+    return makeFileOutput(fileData.d_width, fileData.d_height, channels, fileData.d_colorspace,
+                          std::move(bytes));
 }
 } // namespace qoi
@@ -3,40 +3,75 @@
 #include <qoi_types.h>
 
 #include <cstddef>
+#include <span>
 #include <vector>
 
 namespace qoi {
+// Return the number of pixels in the image of 'fileData' as its header says. Throws if the stream
+// is too short to hold that many pixels, so a lying header is rejected before any buffer is sized
+// from it.
+auto pixelCount(const FileOutput &fileData) -> std::size_t;
+
 class Decoder {
     // TYPES
     using Pixels = std::vector<Pixel>;
-    using Bytes = std::vector<Byte>;
     using Offset = std::size_t;
 
     // DATA
     Pixel d_prevPixel;
-    Pixels d_pixelCache;
+    alignas(64) PixelCache d_pixelCache;
     Pixels d_outputBuffer;
     Offset d_offset;
+    Offset d_initialOffset;
 
     // PRIVATE MANIPULATORS
-    void processRGBAOp(const Bytes &bytes, Pixel &pixel);
-
-    void processRGBOp(const Bytes &bytes, Pixel &pixel);
-
-    void processDiffOp(const Bytes &bytes, Pixel &pixel);
+    template <Channel CHANNELS>
+    void decodePixels(const FileOutput &fileData, Byte *output, std::size_t numPixels);
 
-    void processLumaOp(const Bytes &bytes, Pixel &pixel);
+    template <Channel CHANNELS>
+    void decodeChunks(const FileOutput &fileData, Byte *output, std::size_t numChunks);
 
-    void processIndexOp(const Bytes &bytes, Pixel &pixel);
-
-    void processRunOp(const Bytes &bytes, Pixel &pixel);
+    void decodeToBuffer(const FileOutput &fileData);
 
   public:
     // CREATOR
     Decoder(Offset offset = 0);
 
     // MANIPULATORS
-    DecodedOutput decodeQOI(const FileOutput &fileData);
+
+    // Return to the initial state of a new image, starting again at the offset given on
+    // construction. The output buffer keeps its capacity, so a decoder reused for images of
+    // similar size stops allocating. Every decode starts with this.
+    void reset();
+
+    // Decode 'fileData' into pixels. Called on an lvalue the result is a copy and the decoder
+    // keeps its buffer for the next image; called on an rvalue, e.g.
+    // 'Decoder().decodeQOI(stream)', the buffer is moved into the result instead.
+    DecodedOutput decodeQOI(const FileOutput &fileData) &;
+
+    DecodedOutput decodeQOI(const FileOutput &fileData) &&;
+
+    // Decode 'fileData' straight into 'output' and return the number of pixels written. Throws
+    // unless 'output' holds every pixel of the image.
+    std::size_t decodeQOI(const FileOutput &fileData, std::span<Pixel> output);
+
+    // Decode 'fileData' straight into interleaved bytes with 'channels' (3 or 4) bytes per pixel,
+    // dropping alpha when 'channels' is 3.
+    FileOutput decodeQOIToBytes(const FileOutput &fileData, Channel channels);
+
+    // Decode like above straight into 'output' and return the number of bytes written. Throws
+    // unless 'output' holds every pixel of the image.
+    std::size_t decodeQOIToBytes(const FileOutput &fileData, Channel channels,
+                                 std::span<Byte> output);
+
+    // Decode like above on up to 'numThreads' threads (0 means one per hardware thread). A quick
+    // scan of the op lengths splits any standard QOI stream into chunks, the chunks are decoded
+    // concurrently while the pixels that depend on the preceding chunk are kept as references,
+    // and a short sequential pass fills those in. A chunk whose guesses about the preceding state
+    // turn out wrong is decoded again sequentially, so the result always equals a sequential
+    // decode.
+    FileOutput decodeQOIToBytes(const FileOutput &fileData, Channel channels,
+                                unsigned int numThreads);
 };
 
 } // namespace qoi
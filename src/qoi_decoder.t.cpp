@@ -0,0 +1,153 @@
+#include <qoi_constants.h>
+#include <qoi_decoder.h>
+#include <qoi_encoder.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+auto makeImage(Width width, Height height, Channel channels) -> FileOutput {
+    // flat areas, gradients and noise so that every op kind is produced
+    std::mt19937 generator(3);
+    std::vector<Byte> bytes;
+    for (Height y = 0; y < height; ++y) {
+        for (Width x = 0; x < width; ++x) {
+            const auto noise = static_cast<Byte>(generator());
+            const bool flat = (x / 8 + y / 8) % 3 == 0;
+            bytes.emplace_back(flat ? 10 : static_cast<Byte>(x * 3 + (noise & 1)));
+            bytes.emplace_back(flat ? 20 : static_cast<Byte>(y * 2));
+            bytes.emplace_back(flat ? 30 : static_cast<Byte>(x % 5 == 0 ? noise : x + y));
+            if (channels == 4) {
+                bytes.emplace_back(flat ? 255 : static_cast<Byte>(x % 7 == 0 ? noise : 128));
+            }
+        }
+    }
+
+    return makeFileOutput(width, height, channels, 0, std::move(bytes));
+}
+
+auto withoutHeader(const std::vector<Byte> &encoded, Channel channels, Width width,
+                   Height height) -> FileOutput {
+    return makeFileOutput(width, height, channels, 0,
+                          std::vector<Byte>(encoded.begin() + QOI_HEADER_SIZE, encoded.end()));
+}
+} // namespace
+
+TEST(DecoderTest, roundTripsEncodedImages) {
+    for (Channel channels : {Channel{3}, Channel{4}}) {
+        const auto image = makeImage(83, 41, channels);
+        const auto encoded = Encoder().encodeToQOI(image);
+        const auto decoded = Decoder().decodeQOI(withoutHeader(encoded.d_bytes, channels, 83, 41));
+
+        ASSERT_EQ(decoded.d_pixels.size(), 83 * 41);
+        std::vector<Byte> bytes;
+        convertPixelsToBytes(decoded.d_pixels, bytes, channels);
+        EXPECT_TRUE(std::ranges::equal(bytes, image.d_bytes));
+    }
+}
+
+TEST(DecoderTest, decodesEveryOpKind) {
+    // clang-format off
+    const std::vector<Byte> ops = {
+        QOI_OP_RGBA, 100, 100, 100, 200, // (100, 100, 100, 200)
+        QOI_OP_DIFF | 0x3F,              // +1 on every channel
+        QOI_OP_LUMA | 0,  0x0F,          // green -32, red -40, blue -25
+        QOI_OP_RGB,  1,   2,   3,        // alpha kept from previous pixel
+        QOI_OP_RUN | 1,                  // two more copies
+        QOI_OP_INDEX | 3,                // (101, 101, 101, 200) hashes to 3
+        0, 0, 0, 0, 0, 0, 0, 1};
+    // clang-format on
+    const auto stream = makeFileOutput(7, 1, 4, 0, ops);
+
+    const auto decoded = Decoder().decodeQOI(stream);
+
+    const std::vector<Pixel> expected = {
+        {.d_red = 100, .d_green = 100, .d_blue = 100, .d_alpha = 200},
+        {.d_red = 101, .d_green = 101, .d_blue = 101, .d_alpha = 200},
+        {.d_red = 61, .d_green = 69, .d_blue = 76, .d_alpha = 200},
+        {.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 200},
+        {.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 200},
+        {.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 200},
+        {.d_red = 101, .d_green = 101, .d_blue = 101, .d_alpha = 200}};
+    EXPECT_EQ(decoded.d_pixels, expected);
+}
+
+TEST(DecoderTest, stopsAtHeaderPixelCount) {
+    // a run of 62 pixels against a 2x5 image
+    const auto stream = makeFileOutput(2, 5, 3, 0, {QOI_OP_RUN | 61, 0, 0, 0, 0, 0, 0, 0, 1});
+
+    const auto decoded = Decoder().decodeQOI(stream);
+
+    EXPECT_EQ(decoded.d_pixels.size(), 10);
+}
+
+TEST(DecoderTest, rejectsStreamWithTooFewPixels) {
+    const auto stream = makeFileOutput(4, 4, 3, 0, {QOI_OP_RUN | 3, 0, 0, 0, 0, 0, 0, 0, 1});
+
+    EXPECT_THROW(Decoder().decodeQOI(stream), std::runtime_error);
+}
+
+TEST(DecoderTest, decodesToInterleavedBytes) {
+    const auto image = makeImage(29, 17, 4);
+    const auto stream = withoutHeader(Encoder().encodeToQOI(image).d_bytes, 4, 29, 17);
+
+    const auto rgba = Decoder().decodeQOIToBytes(stream, 4);
+    EXPECT_EQ(rgba.d_channels, 4);
+    EXPECT_TRUE(std::ranges::equal(rgba.d_bytes, image.d_bytes));
+
+    const auto rgb = Decoder().decodeQOIToBytes(stream, 3);
+    ASSERT_EQ(rgb.d_bytes.size(), 29 * 17 * 3);
+    for (std::size_t iter = 0; iter < 29 * 17; ++iter) {
+        EXPECT_EQ(rgb.d_bytes[iter * 3], image.d_bytes[iter * 4]);
+        EXPECT_EQ(rgb.d_bytes[iter * 3 + 1], image.d_bytes[iter * 4 + 1]);
+        EXPECT_EQ(rgb.d_bytes[iter * 3 + 2], image.d_bytes[iter * 4 + 2]);
+    }
+}
+
+TEST(DecoderTest, parallelDecodeMatchesSequentialDecode) {
+    for (Channel channels : {Channel{3}, Channel{4}}) {
+        const auto image = makeImage(640, 480, channels);
+        const auto stream = withoutHeader(Encoder().encodeToQOI(image).d_bytes, channels, 640, 480);
+
+        for (Channel outChannels : {Channel{3}, Channel{4}}) {
+            const auto sequential = Decoder().decodeQOIToBytes(stream, outChannels);
+            const auto parallel = Decoder().decodeQOIToBytes(stream, outChannels, 4);
+            EXPECT_TRUE(std::ranges::equal(parallel.d_bytes, sequential.d_bytes));
+        }
+    }
+}
+
+TEST(DecoderTest, reusedDecoderStartsEveryImageAfresh) {
+    const auto image = makeImage(31, 9, 3);
+    const auto stream = withoutHeader(Encoder().encodeToQOI(image).d_bytes, 3, 31, 9);
+
+    Decoder decoder;
+    for (int iter = 0; iter < 3; ++iter) {
+        EXPECT_TRUE(std::ranges::equal(decoder.decodeQOIToBytes(stream, 3).d_bytes, image.d_bytes));
+    }
+}
+
+TEST(DecoderTest, decodesIntoCallerBuffers) {
+    const auto image = makeImage(21, 13, 4);
+    const auto stream = withoutHeader(Encoder().encodeToQOI(image).d_bytes, 4, 21, 13);
+
+    std::vector<Pixel> pixels(21 * 13);
+    EXPECT_EQ(Decoder().decodeQOI(stream, pixels), 21 * 13);
+    EXPECT_EQ(pixels, Decoder().decodeQOI(stream).d_pixels);
+
+    std::vector<Byte> bytes(21 * 13 * 3);
+    EXPECT_EQ(Decoder().decodeQOIToBytes(stream, 3, bytes), bytes.size());
+    EXPECT_TRUE(std::ranges::equal(bytes, Decoder().decodeQOIToBytes(stream, 3).d_bytes));
+
+    std::vector<Byte> tooSmall(21 * 13 * 3 - 1);
+    EXPECT_THROW(Decoder().decodeQOIToBytes(stream, 3, tooSmall), std::runtime_error);
+}
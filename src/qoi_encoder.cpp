@@ -1,72 +1,98 @@
 #include <qoi_encoder.h>
 
 #include <qoi_constants.h>
+#include <qoi_simd.h>
 #include <qoi_types.h>
 #include <qoi_utils.h>
 
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
 namespace qoi {
-// CREATORS
-Encoder::Encoder()
-    : d_prevPixel{.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255}, d_pixelCache(64),
-      d_encodedBuffer(), d_run{0} {
-    d_encodedBuffer.reserve(10000000);
-}
+namespace {
+// Chunks smaller than this cost more to hand to a thread than they take to encode.
+constexpr std::size_t MIN_CHUNK_PIXELS = 1 << 16;
 
-// MANIPULATORS
-EncodedOutput Encoder::encodeToQOI(const FileOutput &fileData) {
+// Check that 'fileData' holds exactly width * height pixels of 3 or 4 channels and return the
+// number of pixels.
+auto validatePixelData(const FileOutput &fileData) -> std::size_t {
     const auto pixelChannels = static_cast<std::size_t>(fileData.d_channels);
-    if (pixelChannels < 3) {
+    if (pixelChannels != 3 && pixelChannels != 4) {
         throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
     }
 
-    if (fileData.d_bytes.size() % pixelChannels != 0) {
+    const auto numPixels =
+        static_cast<std::size_t>(fileData.d_width) * static_cast<std::size_t>(fileData.d_height);
+    if (fileData.d_bytes.size() != numPixels * pixelChannels) {
         throw std::runtime_error("The data is corrupted or incomplete");
     }
 
+    return numPixels;
+}
+
+auto writeHeader(const FileOutput &fileData, Byte *cursor) -> Byte * {
     // write header
-    d_encodedBuffer.insert(d_encodedBuffer.cend(), QOI_MAGIC_TAG.cbegin(), QOI_MAGIC_TAG.cend());
+    cursor = std::copy(QOI_MAGIC_TAG.cbegin(), QOI_MAGIC_TAG.cend(), cursor);
 
     // write width
-    writeU32(fileData.d_width, d_encodedBuffer);
+    writeU32(fileData.d_width, cursor);
 
     // write height
-    writeU32(fileData.d_height, d_encodedBuffer);
+    writeU32(fileData.d_height, cursor);
 
     // write channels
-    d_encodedBuffer.emplace_back(fileData.d_channels);
+    *cursor++ = fileData.d_channels;
 
     // write colorspace
-    d_encodedBuffer.emplace_back(fileData.d_colorspace);
-
-    // write pixels data
-    const auto &bytes = fileData.d_bytes;
-    for (auto iter = 0; iter != bytes.size(); iter += pixelChannels) {
-        auto currPixel = Pixel{.d_red = bytes[iter],
-                               .d_green = bytes[iter + 1],
-                               .d_blue = bytes[iter + 2],
-                               .d_alpha = 255};
-        if (pixelChannels == 4) {
-            currPixel.d_alpha = bytes[iter + 3];
+    *cursor++ = fileData.d_colorspace;
+
+    return cursor;
+}
+} // namespace
+
+// CREATORS
+Encoder::Encoder()
+    : d_prevPixel{.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255}, d_pixelCache(),
+      d_encodedBuffer(), d_run{0} {}
+
+// PRIVATE MANIPULATORS
+template <Channel CHANNELS>
+Byte *Encoder::encodePixels(std::span<const Byte> bytes, Byte *cursor) {
+    const auto numPixels = bytes.size() / CHANNELS;
+    for (std::size_t iter = 0; iter != bytes.size(); iter += CHANNELS) {
+        Pixel currPixel;
+        if constexpr (CHANNELS == 4) {
+            currPixel = loadPixel(&bytes[iter]);
+        } else {
+            currPixel = Pixel{.d_red = bytes[iter],
+                              .d_green = bytes[iter + 1],
+                              .d_blue = bytes[iter + 2],
+                              .d_alpha = 255};
         }
 
         if (currPixel == d_prevPixel) {
-            ++d_run;
-            if (d_run == 62) {
-                d_encodedBuffer.emplace_back(QOI_OP_RUN | d_run - 1);
-                d_run = 0;
-            }
+            // scan the whole run at once and emit every completed 62 pixel run in bulk
+            const auto runLength =
+                matchRunLength<CHANNELS>(&bytes[iter], numPixels - iter / CHANNELS, d_prevPixel);
+            d_run += runLength;
+            cursor = std::fill_n(cursor, d_run / 62, QOI_OP_RUN | 61);
+            d_run %= 62;
 
+            iter += (runLength - 1) * CHANNELS;
             continue;
         }
 
         if (d_run > 0) {
-            d_encodedBuffer.emplace_back(QOI_OP_RUN | d_run - 1);
+            *cursor++ = QOI_OP_RUN | d_run - 1;
             d_run = 0;
         }
 
         int index = hashIndex(currPixel);
         if (d_pixelCache[index] == currPixel) {
-            d_encodedBuffer.emplace_back(QOI_OP_INDEX | index);
+            *cursor++ = QOI_OP_INDEX | index;
         } else if (currPixel.d_alpha == d_prevPixel.d_alpha) {
             int dr = currPixel.d_red - d_prevPixel.d_red;
             int dg = currPixel.d_green - d_prevPixel.d_green;
@@ -76,38 +102,196 @@ EncodedOutput Encoder::encodeToQOI(const FileOutput &fileData) {
             int db_dg = db - dg;
 
             if ((dr >= -2 && dr <= 1) && (dg >= -2 && dg <= 1) && (db >= -2 && db <= 1)) {
-                d_encodedBuffer.emplace_back(QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) |
-                                             (db + 2));
+                *cursor++ = QOI_OP_DIFF | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
             } else if ((dg >= -32 && dg <= 31) && (dr_dg >= -8 && dr_dg <= 7) &&
                        (db_dg >= -8 && db_dg <= 7)) {
-                d_encodedBuffer.emplace_back(QOI_OP_LUMA | (dg + 32));
-                d_encodedBuffer.emplace_back(((dr_dg + 8) << 4) | (db_dg + 8));
+                *cursor++ = QOI_OP_LUMA | (dg + 32);
+                *cursor++ = ((dr_dg + 8) << 4) | (db_dg + 8);
             } else {
-                d_encodedBuffer.emplace_back(QOI_OP_RGB);
-                d_encodedBuffer.emplace_back(currPixel.d_red);
-                d_encodedBuffer.emplace_back(currPixel.d_green);
-                d_encodedBuffer.emplace_back(currPixel.d_blue);
+                // the stray alpha byte is overwritten by the next op or the end marker
+                *cursor = QOI_OP_RGB;
+                storePixel(cursor + 1, currPixel);
+                cursor += 4;
             }
         } else {
-            d_encodedBuffer.emplace_back(QOI_OP_RGBA);
-            d_encodedBuffer.emplace_back(currPixel.d_red);
-            d_encodedBuffer.emplace_back(currPixel.d_green);
-            d_encodedBuffer.emplace_back(currPixel.d_blue);
-            d_encodedBuffer.emplace_back(currPixel.d_alpha);
+            *cursor = QOI_OP_RGBA;
+            storePixel(cursor + 1, currPixel);
+            cursor += 5;
         }
 
         d_pixelCache[index] = currPixel;
         d_prevPixel = currPixel;
     }
 
+    return cursor;
+}
+
+template Byte *Encoder::encodePixels<3>(std::span<const Byte>, Byte *);
+template Byte *Encoder::encodePixels<4>(std::span<const Byte>, Byte *);
+
+template <Channel CHANNELS>
+void Encoder::startIndependentChunk(std::span<const Byte> bytes) {
+    // Prime the state so the chunk never refers to pixels before it. No index slot holds a pixel
+    // that hashes to that slot, so QOI_OP_INDEX only fires for slots the chunk wrote itself, and
+    // the previous pixel differs from the first one in a way that only QOI_OP_RGBA (4 channels)
+    // or QOI_OP_RGB (3 channels, alpha is always 255) can express.
+    d_pixelCache.fill(Pixel{});
+    d_pixelCache[0] = Pixel{.d_red = 1};
+
+    Pixel primed{.d_red = bytes[0], .d_green = bytes[1], .d_blue = bytes[2], .d_alpha = 255};
+    if constexpr (CHANNELS == 4) {
+        primed.d_alpha = bytes[3] ^ 0xFF;
+    } else {
+        primed.d_red ^= 0x80;
+        primed.d_green ^= 0x80;
+        primed.d_blue ^= 0x80;
+    }
+
+    d_prevPixel = primed;
+    d_run = 0;
+}
+
+template <Channel CHANNELS>
+std::vector<Encoder::Bytes> Encoder::encodeChunks(const FileOutput &fileData,
+                                                  std::size_t numChunks) {
+    const auto numPixels = fileData.d_bytes.size() / CHANNELS;
+    const auto chunkPixels = (numPixels + numChunks - 1) / numChunks;
+    std::vector<Bytes> chunkOutputs(numChunks);
+
+    auto encodeChunk = [&](std::size_t chunk) {
+        const auto first = chunk * chunkPixels;
+        const auto count = std::min(chunkPixels, numPixels - first);
+        const auto bytes = fileData.d_bytes.subspan(first * CHANNELS, count * CHANNELS);
+
+        // worst case per pixel, plus room for the stray alpha byte of a trailing QOI_OP_RGB
+        auto &output = chunkOutputs[chunk];
+        output.resize(count * (CHANNELS + 1) + sizeof(Pixel));
+
+        // the first chunk continues from the standard initial state like a sequential encode
+        Encoder encoder;
+        if (chunk != 0) {
+            encoder.startIndependentChunk<CHANNELS>(bytes);
+        }
+
+        Byte *cursor = encoder.encodePixels<CHANNELS>(bytes, output.data());
+        cursor = encoder.flushRun(cursor);
+        output.resize(cursor - output.data());
+    };
+
+    {
+        std::vector<std::jthread> workers;
+        for (std::size_t chunk = 1; chunk < numChunks; ++chunk) {
+            workers.emplace_back(encodeChunk, chunk);
+        }
+
+        encodeChunk(0);
+    }
+
+    return chunkOutputs;
+}
+
+Byte *Encoder::encodeImage(const FileOutput &fileData, Byte *cursor) {
+    cursor = writeHeader(fileData, cursor);
+
+    // write pixels data, choosing the pixel layout once for the whole image
+    if (fileData.d_channels == 4) {
+        cursor = encodePixels<4>(fileData.d_bytes, cursor);
+    } else {
+        cursor = encodePixels<3>(fileData.d_bytes, cursor);
+    }
+
+    cursor = flushRun(cursor);
+
+    // write end marker
+    return std::copy(QOI_END_MARKER.cbegin(), QOI_END_MARKER.cend(), cursor);
+}
+
+void Encoder::encodeToBuffer(const FileOutput &fileData) {
+    validatePixelData(fileData);
+    reset();
+
+    // allocate the worst case once, every write below goes through the raw cursor
+    d_encodedBuffer.resize(
+        maxEncodedSize(fileData.d_width, fileData.d_height, fileData.d_channels));
+    Byte *cursor = encodeImage(fileData, d_encodedBuffer.data());
+    d_encodedBuffer.resize(cursor - d_encodedBuffer.data());
+}
+
+void Encoder::encodeToBuffer(const FileOutput &fileData, unsigned int numThreads) {
+    const auto numPixels = validatePixelData(fileData);
+    reset();
+
+    if (numThreads == 0) {
+        numThreads = std::max(1U, std::thread::hardware_concurrency());
+    }
+
+    const auto numChunks = std::clamp<std::size_t>(numPixels / MIN_CHUNK_PIXELS, 1, numThreads);
+    if (numChunks == 1) {
+        encodeToBuffer(fileData);
+        return;
+    }
+
+    const auto chunkOutputs = fileData.d_channels == 4 ? encodeChunks<4>(fileData, numChunks)
+                                                       : encodeChunks<3>(fileData, numChunks);
+
+    // the chunks are plain op sequences, so the file is their concatenation
+    std::size_t encodedSize = QOI_HEADER_SIZE + QOI_END_MARKER.size();
+    for (const auto &chunkOutput : chunkOutputs) {
+        encodedSize += chunkOutput.size();
+    }
+
+    d_encodedBuffer.resize(encodedSize);
+    Byte *cursor = writeHeader(fileData, d_encodedBuffer.data());
+    for (const auto &chunkOutput : chunkOutputs) {
+        cursor = std::copy(chunkOutput.cbegin(), chunkOutput.cend(), cursor);
+    }
+
+    std::copy(QOI_END_MARKER.cbegin(), QOI_END_MARKER.cend(), cursor);
+}
+
+Byte *Encoder::flushRun(Byte *cursor) {
     if (d_run > 0) {
-        d_encodedBuffer.emplace_back(QOI_OP_RUN | d_run - 1);
+        *cursor++ = QOI_OP_RUN | d_run - 1;
         d_run = 0;
     }
 
-    // write end marker
-    d_encodedBuffer.insert(d_encodedBuffer.end(), QOI_END_MARKER.cbegin(), QOI_END_MARKER.cend());
+    return cursor;
+}
+
+// MANIPULATORS
+void Encoder::reset() {
+    d_prevPixel = {.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255};
+    d_pixelCache.fill(Pixel{});
+    d_run = 0;
+}
+
+EncodedOutput Encoder::encodeToQOI(const FileOutput &fileData) & {
+    encodeToBuffer(fileData);
+    return {.d_bytes = d_encodedBuffer};
+}
+
+EncodedOutput Encoder::encodeToQOI(const FileOutput &fileData) && {
+    encodeToBuffer(fileData);
+    return {.d_bytes = std::move(d_encodedBuffer)};
+}
 
+EncodedOutput Encoder::encodeToQOI(const FileOutput &fileData, unsigned int numThreads) & {
+    encodeToBuffer(fileData, numThreads);
     return {.d_bytes = d_encodedBuffer};
 }
+
+EncodedOutput Encoder::encodeToQOI(const FileOutput &fileData, unsigned int numThreads) && {
+    encodeToBuffer(fileData, numThreads);
+    return {.d_bytes = std::move(d_encodedBuffer)};
+}
+
+std::size_t Encoder::encodeToQOI(const FileOutput &fileData, std::span<Byte> output) {
+    validatePixelData(fileData);
+    if (output.size() < maxEncodedSize(fileData.d_width, fileData.d_height, fileData.d_channels)) {
+        throw std::runtime_error("The output buffer is smaller than the largest possible encoding");
+    }
+
+    reset();
+    return encodeImage(fileData, output.data()) - output.data();
+}
 } // namespace qoi
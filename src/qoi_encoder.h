@@ -3,25 +3,73 @@
 #include <qoi_types.h>
 
 #include <cstddef>
+#include <span>
 #include <vector>
 
 namespace qoi {
 class Encoder {
+    // the streaming encoder drives the same kernel one piece of the image at a time
+    friend class StreamEncoder;
+
     // TYPES
-    using Pixels = std::vector<Pixel>;
     using Bytes = std::vector<Byte>;
 
     // DATA
     Pixel d_prevPixel;
-    Pixels d_pixelCache;
+    alignas(64) PixelCache d_pixelCache;
     Bytes d_encodedBuffer;
-    int d_run;
+    std::size_t d_run;
+
+    // PRIVATE MANIPULATORS
+    template <Channel CHANNELS>
+    Byte *encodePixels(std::span<const Byte> bytes, Byte *cursor);
+
+    template <Channel CHANNELS>
+    void startIndependentChunk(std::span<const Byte> bytes);
+
+    template <Channel CHANNELS>
+    std::vector<Bytes> encodeChunks(const FileOutput &fileData, std::size_t numChunks);
+
+    // Write the whole QOI file for 'fileData' from 'cursor' on and return its end.
+    Byte *encodeImage(const FileOutput &fileData, Byte *cursor);
+
+    void encodeToBuffer(const FileOutput &fileData);
+
+    void encodeToBuffer(const FileOutput &fileData, unsigned int numThreads);
+
+    Byte *flushRun(Byte *cursor);
 
   public:
     // CREATORS
     Encoder();
 
     // MANIPULATORS
-    EncodedOutput encodeToQOI(const FileOutput &fileData);
+
+    // Return to the initial state of a new image. The encoded buffer keeps its capacity, so an
+    // encoder reused for images of similar size stops allocating. Every encode starts with this.
+    void reset();
+
+    // Encode 'fileData'. Called on an lvalue the result is a copy and the encoder keeps its
+    // buffer for the next image; called on an rvalue, e.g. 'Encoder().encodeToQOI(image)', the
+    // buffer is moved into the result instead.
+    EncodedOutput encodeToQOI(const FileOutput &fileData) &;
+
+    EncodedOutput encodeToQOI(const FileOutput &fileData) &&;
+
+    // Encode 'fileData' on up to 'numThreads' threads (0 means one per hardware thread). The
+    // pixels are split into chunks that each start with an explicit QOI_OP_RGBA/QOI_OP_RGB and
+    // only index pixels they wrote themselves, so the result is a standard QOI stream that any
+    // decoder can read. It is slightly larger than a sequential encode, and identical to it when
+    // a single chunk is used. The result is copied or moved out like above.
+    EncodedOutput encodeToQOI(const FileOutput &fileData, unsigned int numThreads) &;
+
+    EncodedOutput encodeToQOI(const FileOutput &fileData, unsigned int numThreads) &&;
+
+    // Encode 'fileData' straight into 'output' and return the number of bytes written. Throws
+    // unless 'output' holds at least 'maxEncodedSize' bytes for the image.
+    std::size_t encodeToQOI(const FileOutput &fileData, std::span<Byte> output);
 };
+
+extern template Byte *Encoder::encodePixels<3>(std::span<const Byte>, Byte *);
+extern template Byte *Encoder::encodePixels<4>(std::span<const Byte>, Byte *);
 } // namespace qoi
@@ -0,0 +1,118 @@
+#include <qoi_constants.h>
+#include <qoi_decoder.h>
+#include <qoi_encoder.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+auto makeNoise(Width width, Height height, Channel channels) -> FileOutput {
+    std::mt19937 generator(42);
+    std::vector<Byte> bytes(static_cast<std::size_t>(width) * height * channels);
+    for (auto &byte : bytes) {
+        byte = static_cast<Byte>(generator());
+    }
+
+    return makeFileOutput(width, height, channels, 0, std::move(bytes));
+}
+} // namespace
+
+TEST(EncoderTest, incompressibleImageStaysWithinBound) {
+    for (Channel channels : {Channel{3}, Channel{4}}) {
+        const auto image = makeNoise(67, 31, channels);
+        const auto encoded = Encoder().encodeToQOI(image);
+
+        EXPECT_LE(encoded.d_bytes.size(), maxEncodedSize(67, 31, channels));
+        EXPECT_TRUE(hasValidEndMarker(encoded.d_bytes));
+
+        std::size_t offset = 0;
+        QOIHeader header{};
+        extractHeader(encoded.d_bytes, header, offset);
+        EXPECT_EQ(header.d_magic, QOI_MAGIC_TAG);
+        EXPECT_EQ(header.d_width, 67);
+        EXPECT_EQ(header.d_height, 31);
+        EXPECT_EQ(header.d_channels, channels);
+    }
+}
+
+TEST(EncoderTest, flatImageEncodesToRuns) {
+    const auto image = makeFileOutput(100, 1, 3, 0, std::vector<Byte>(300, 0));
+    const auto encoded = Encoder().encodeToQOI(image);
+
+    // black repeats the initial previous pixel, so the image is a run of 62 and one of 38
+    const std::vector<Byte> expectedOps = {QOI_OP_RUN | 61, QOI_OP_RUN | 37};
+    ASSERT_EQ(encoded.d_bytes.size(), QOI_HEADER_SIZE + expectedOps.size() + 8);
+    EXPECT_TRUE(std::equal(expectedOps.begin(), expectedOps.end(),
+                           encoded.d_bytes.begin() + QOI_HEADER_SIZE));
+}
+
+TEST(EncoderTest, rejectsMismatchedPixelData) {
+    auto image = makeNoise(4, 4, 4);
+    image.d_bytes = image.d_bytes.first(image.d_bytes.size() - 4);
+
+    EXPECT_THROW(Encoder().encodeToQOI(image), std::runtime_error);
+}
+
+TEST(EncoderTest, parallelEncodeIsAStandardStream) {
+    for (Channel channels : {Channel{3}, Channel{4}}) {
+        // mostly flat so runs and index ops cross the chunk boundaries
+        auto noise = makeNoise(640, 480, channels);
+        std::vector<Byte> bytes(noise.d_bytes.begin(), noise.d_bytes.end());
+        for (std::size_t iter = 0; iter < bytes.size(); ++iter) {
+            if ((iter / channels / 97) % 4 != 0) {
+                bytes[iter] = static_cast<Byte>(iter / channels / 1000);
+            }
+        }
+        const auto image = makeFileOutput(640, 480, channels, 0, bytes);
+
+        const auto sequential = Encoder().encodeToQOI(image);
+        const auto parallel = Encoder().encodeToQOI(image, 4);
+        EXPECT_NE(parallel.d_bytes, sequential.d_bytes);
+        EXPECT_LE(parallel.d_bytes.size(), maxEncodedSize(640, 480, channels));
+
+        const auto stream = makeFileOutput(
+            640, 480, channels, 0,
+            std::vector<Byte>(parallel.d_bytes.begin() + QOI_HEADER_SIZE, parallel.d_bytes.end()));
+        const auto decoded = Decoder().decodeQOIToBytes(stream, channels);
+        EXPECT_TRUE(std::ranges::equal(decoded.d_bytes, image.d_bytes));
+    }
+}
+
+TEST(EncoderTest, singleThreadMatchesSequentialEncode) {
+    const auto image = makeNoise(300, 300, 4);
+
+    EXPECT_EQ(Encoder().encodeToQOI(image, 1).d_bytes, Encoder().encodeToQOI(image).d_bytes);
+}
+
+TEST(EncoderTest, reusedEncoderStartsEveryImageAfresh) {
+    const auto noise = makeNoise(24, 24, 4);
+    const auto flat = makeFileOutput(8, 8, 4, 0, std::vector<Byte>(8 * 8 * 4, 90));
+
+    Encoder encoder;
+    const auto first = encoder.encodeToQOI(noise);
+    encoder.encodeToQOI(flat);
+
+    EXPECT_EQ(encoder.encodeToQOI(noise).d_bytes, first.d_bytes);
+}
+
+TEST(EncoderTest, encodesIntoCallerBuffer) {
+    const auto image = makeNoise(19, 11, 3);
+    const auto expected = Encoder().encodeToQOI(image).d_bytes;
+
+    std::vector<Byte> output(maxEncodedSize(19, 11, 3));
+    const auto size = Encoder().encodeToQOI(image, output);
+    output.resize(size);
+    EXPECT_EQ(output, expected);
+
+    std::vector<Byte> tooSmall(maxEncodedSize(19, 11, 3) - 1);
+    EXPECT_THROW(Encoder().encodeToQOI(image, tooSmall), std::runtime_error);
+}
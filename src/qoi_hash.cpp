@@ -0,0 +1,136 @@
+#include <qoi_hash.h>
+
+#include <qoi_mappedfile.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace qoi {
+namespace {
+constexpr std::uint64_t PRIME_1 = 0x9E3779B185EBCA87;
+constexpr std::uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4F;
+constexpr std::uint64_t PRIME_3 = 0x165667B19E3779F9;
+constexpr std::uint64_t PRIME_4 = 0x85EBCA77C2B2AE63;
+constexpr std::uint64_t PRIME_5 = 0x27D4EB2F165667C5;
+
+// the hash is defined on little endian words whatever the machine
+auto load64(const Byte *bytes) -> std::uint64_t {
+    std::uint64_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return std::endian::native == std::endian::little ? value : std::byteswap(value);
+}
+
+auto load32(const Byte *bytes) -> std::uint32_t {
+    std::uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return std::endian::native == std::endian::little ? value : std::byteswap(value);
+}
+
+auto round(std::uint64_t accumulator, std::uint64_t input) -> std::uint64_t {
+    accumulator += input * PRIME_2;
+    return std::rotl(accumulator, 31) * PRIME_1;
+}
+
+auto mergeRound(std::uint64_t accumulator, std::uint64_t lane) -> std::uint64_t {
+    accumulator ^= round(0, lane);
+    return accumulator * PRIME_1 + PRIME_4;
+}
+} // namespace
+
+// CREATORS
+ContentHasher::ContentHasher(std::uint64_t seed)
+    : d_lanes{seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1}, d_pending(),
+      d_numPending(0), d_length(0), d_seed(seed) {}
+
+// MANIPULATORS
+void ContentHasher::update(std::span<const Byte> bytes) {
+    const Byte *input = bytes.data();
+    const Byte *const end = input + bytes.size();
+    d_length += bytes.size();
+
+    if (d_numPending + bytes.size() < d_pending.size()) {
+        std::copy(input, end, d_pending.begin() + d_numPending);
+        d_numPending += bytes.size();
+        return;
+    }
+
+    // four independent lanes keep the multipliers of the CPU busy
+    auto [lane1, lane2, lane3, lane4] = d_lanes;
+    const auto stripe = [&](const Byte *data) {
+        lane1 = round(lane1, load64(data));
+        lane2 = round(lane2, load64(data + 8));
+        lane3 = round(lane3, load64(data + 16));
+        lane4 = round(lane4, load64(data + 24));
+    };
+
+    if (d_numPending > 0) {
+        const std::size_t fill = d_pending.size() - d_numPending;
+        std::copy(input, input + fill, d_pending.begin() + d_numPending);
+        stripe(d_pending.data());
+        input += fill;
+    }
+
+    for (; end - input >= 32; input += 32) {
+        stripe(input);
+    }
+
+    d_lanes = {lane1, lane2, lane3, lane4};
+    d_numPending = static_cast<std::size_t>(end - input);
+    std::copy(input, end, d_pending.begin());
+}
+
+// ACCESSORS
+std::uint64_t ContentHasher::digest() const {
+    std::uint64_t hash;
+    if (d_length >= 32) {
+        const auto [lane1, lane2, lane3, lane4] = d_lanes;
+        hash = std::rotl(lane1, 1) + std::rotl(lane2, 7) + std::rotl(lane3, 12) +
+               std::rotl(lane4, 18);
+        hash = mergeRound(hash, lane1);
+        hash = mergeRound(hash, lane2);
+        hash = mergeRound(hash, lane3);
+        hash = mergeRound(hash, lane4);
+    } else {
+        hash = d_seed + PRIME_5;
+    }
+
+    hash += d_length;
+
+    const Byte *input = d_pending.data();
+    const Byte *const end = input + d_numPending;
+    for (; end - input >= 8; input += 8) {
+        hash ^= round(0, load64(input));
+        hash = std::rotl(hash, 27) * PRIME_1 + PRIME_4;
+    }
+
+    if (end - input >= 4) {
+        hash ^= load32(input) * PRIME_1;
+        hash = std::rotl(hash, 23) * PRIME_2 + PRIME_3;
+        input += 4;
+    }
+
+    for (; input < end; ++input) {
+        hash ^= *input * PRIME_5;
+        hash = std::rotl(hash, 11) * PRIME_1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+auto hashContent(std::span<const Byte> bytes, std::uint64_t seed) -> std::uint64_t {
+    ContentHasher hasher(seed);
+    hasher.update(bytes);
+    return hasher.digest();
+}
+
+auto hashFile(const std::filesystem::path &filename) -> std::uint64_t {
+    const MappedFile file(filename);
+    return hashContent(file.bytes());
+}
+} // namespace qoi
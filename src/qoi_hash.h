@@ -0,0 +1,45 @@
+#pragma once
+
+#include <qoi_types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+namespace qoi {
+// The XXH64 hash of bytes that arrive in pieces, e.g. the header and the pixels of a file written
+// separately. The digest equals 'hashContent' of all the pieces put together.
+class ContentHasher {
+    // DATA
+    std::array<std::uint64_t, 4> d_lanes;
+    std::array<Byte, 32> d_pending; // bytes of a stripe not complete yet
+    std::size_t d_numPending;
+    std::uint64_t d_length;
+    std::uint64_t d_seed;
+
+  public:
+    // CREATORS
+    explicit ContentHasher(std::uint64_t seed = 0);
+
+    // MANIPULATORS
+
+    // Hash 'bytes' after those given before.
+    void update(std::span<const Byte> bytes);
+
+    // ACCESSORS
+
+    // Return the hash of every byte given so far.
+    std::uint64_t digest() const;
+};
+
+// Return the 64-bit XXH64 hash of 'bytes' with 'seed'. The hash is fast, several bytes per cycle,
+// and good at telling files apart, but not cryptographic: it is meant to notice changed or
+// duplicate content, not to resist anyone forging a collision.
+auto hashContent(std::span<const Byte> bytes, std::uint64_t seed = 0) -> std::uint64_t;
+
+// Return 'hashContent' of the whole file 'filename', which is mapped rather than copied. Throws
+// if the file cannot be read.
+auto hashFile(const std::filesystem::path &filename) -> std::uint64_t;
+} // namespace qoi
@@ -0,0 +1,55 @@
+#include <qoi_hash.h>
+
+#include <gtest/gtest.h>
+
+#include <string_view>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+auto hashText(std::string_view text, std::uint64_t seed = 0) -> std::uint64_t {
+    return hashContent({reinterpret_cast<const Byte *>(text.data()), text.size()}, seed);
+}
+} // namespace
+
+TEST(HashContentTest, matchesReferenceValues) {
+    EXPECT_EQ(hashText(""), 0xEF46DB3751D8E999);
+    EXPECT_EQ(hashText("a"), 0xD24EC4F1A98C6E5B);
+    EXPECT_EQ(hashText("abc"), 0x44BC2CF5AD770999);
+}
+
+TEST(HashContentTest, coversEveryByteOfEveryLength) {
+    // lengths around each of the 32, 8, 4 and 1 byte steps
+    std::vector<Byte> bytes(100);
+    for (std::size_t length = 0; length < bytes.size(); ++length) {
+        const std::span<const Byte> prefix = std::span<const Byte>(bytes).first(length);
+        const auto hash = hashContent(prefix);
+        for (std::size_t byte = 0; byte < length; ++byte) {
+            bytes[byte] ^= 1;
+            EXPECT_NE(hashContent(prefix), hash) << length << ' ' << byte;
+            bytes[byte] ^= 1;
+        }
+    }
+
+    EXPECT_NE(hashText("abc", 1), hashText("abc"));
+}
+
+TEST(HashContentTest, hashesPiecesLikeTheirConcatenation) {
+    std::vector<Byte> bytes(200);
+    for (std::size_t byte = 0; byte < bytes.size(); ++byte) {
+        bytes[byte] = static_cast<Byte>(byte * 7);
+    }
+
+    // every split point, so that pieces end before, inside and after a 32 byte stripe
+    for (const std::size_t length : {std::size_t{20}, std::size_t{70}, bytes.size()}) {
+        const std::span<const Byte> whole = std::span<const Byte>(bytes).first(length);
+        for (std::size_t split = 0; split <= length; ++split) {
+            ContentHasher hasher(5);
+            hasher.update(whole.first(split));
+            hasher.update({});
+            hasher.update(whole.subspan(split));
+            EXPECT_EQ(hasher.digest(), hashContent(whole, 5)) << length << ' ' << split;
+        }
+    }
+}
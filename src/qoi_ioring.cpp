@@ -0,0 +1,427 @@
+#include <qoi_ioring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+#if defined(QOI_HAVE_IO_URING)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace qoi {
+namespace {
+// A single read or write may not exceed what the length field of a transfer holds.
+constexpr std::size_t MAX_TRANSFER_SIZE = std::size_t{1} << 30;
+
+// One contiguous part of a file to read or write.
+struct Transfer {
+    std::size_t d_file;
+    int d_fd;
+    Byte *d_data;
+    std::size_t d_size;
+    std::uint64_t d_offset;
+};
+
+#if defined(QOI_HAVE_IO_URING)
+// An open file descriptor, closed when it goes out of scope unless it was closed before, so that
+// a ring failing in the middle of a batch does not leak the files of the batch.
+class FileDescriptor {
+    // DATA
+    int d_fd;
+
+  public:
+    // CREATORS
+    explicit FileDescriptor(int fd) : d_fd(fd) {}
+
+    FileDescriptor(FileDescriptor &&other) noexcept : d_fd(std::exchange(other.d_fd, -1)) {}
+
+    FileDescriptor(const FileDescriptor &) = delete;
+
+    FileDescriptor &operator=(const FileDescriptor &) = delete;
+
+    ~FileDescriptor() { close(); }
+
+    // MANIPULATORS
+
+    // Close the descriptor if it is open and return the error number of closing it, or 0.
+    int close() {
+        const int fd = std::exchange(d_fd, -1);
+        return fd >= 0 && ::close(fd) != 0 ? errno : 0;
+    }
+
+    // ACCESSORS
+    int get() const { return d_fd; }
+};
+#endif
+
+// Append the transfers moving 'size' bytes at 'data' to or from offset 'offset' of 'fd'.
+auto splitTransfers(std::size_t file, int fd, Byte *data, std::size_t size, std::uint64_t offset,
+                    std::vector<Transfer> &transfers) -> void {
+    for (std::size_t done = 0; done < size; done += MAX_TRANSFER_SIZE) {
+        transfers.push_back({.d_file = file,
+                             .d_fd = fd,
+                             .d_data = data + done,
+                             .d_size = std::min(MAX_TRANSFER_SIZE, size - done),
+                             .d_offset = offset + done});
+    }
+}
+
+// Run every transfer of 'transfers' through 'ring', continuing the short ones where they stopped,
+// and record the error number of the first failure of each file in 'errors'. The transfers of a
+// file that failed are dropped.
+auto runTransfers(IoRing &ring, std::vector<Transfer> &transfers, bool write,
+                  std::vector<int> &errors) -> void {
+    const auto queue = [&](std::size_t index) {
+        const Transfer &transfer = transfers[index];
+        if (write) {
+            ring.queueWrite(transfer.d_fd, {transfer.d_data, transfer.d_size}, transfer.d_offset,
+                            index);
+        } else {
+            ring.queueRead(transfer.d_fd, {transfer.d_data, transfer.d_size}, transfer.d_offset,
+                           index);
+        }
+    };
+
+    std::size_t next = 0;
+    while (next < transfers.size() || ring.isBusy()) {
+        for (; next < transfers.size() && ring.hasRoom(); ++next) {
+            if (errors[transfers[next].d_file] == 0) {
+                queue(next);
+            }
+        }
+
+        if (!ring.isBusy()) {
+            continue;
+        }
+
+        const IoRing::Completion completion = ring.wait();
+        Transfer &transfer = transfers[completion.d_tag];
+        if (completion.d_result <= 0) {
+            // a read returning nothing means the file got shorter after it was opened
+            if (errors[transfer.d_file] == 0) {
+                errors[transfer.d_file] = completion.d_result < 0 ? -completion.d_result : EIO;
+            }
+
+            continue;
+        }
+
+        const auto done = static_cast<std::size_t>(completion.d_result);
+        transfer.d_data += done;
+        transfer.d_size -= done;
+        transfer.d_offset += done;
+        if (transfer.d_size > 0 && errors[transfer.d_file] == 0) {
+            // the completion just collected left room for the rest
+            queue(completion.d_tag);
+        }
+    }
+}
+} // namespace
+
+// CREATORS
+IoRing::IoRing(unsigned int numEntries)
+    : d_fd(-1), d_sqRing(nullptr), d_sqRingSize(0), d_cqRing(nullptr), d_cqRingSize(0),
+      d_sqes(nullptr), d_sqesSize(0), d_sqHead(nullptr), d_sqTail(nullptr), d_sqArray(nullptr),
+      d_sqMask(0), d_numEntries(0), d_cqHead(nullptr), d_cqTail(nullptr), d_cqes(nullptr),
+      d_cqMask(0), d_numQueued(0), d_numInFlight(0) {
+#if defined(QOI_HAVE_IO_URING)
+    io_uring_params params{};
+    d_fd = static_cast<int>(::syscall(__NR_io_uring_setup, std::max(1u, numEntries), &params));
+    if (d_fd < 0) {
+        throw std::runtime_error(std::string("io_uring is not available: ") +
+                                 std::strerror(errno));
+    }
+
+    d_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    d_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    d_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+    // newer kernels share one mapping between both rings
+    const bool singleMapping = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMapping) {
+        d_sqRingSize = d_cqRingSize = std::max(d_sqRingSize, d_cqRingSize);
+    }
+
+    const auto map = [&](std::size_t size, off_t offset) -> void * {
+        void *mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                               d_fd, offset);
+        if (mapping == MAP_FAILED) {
+            const int error = errno;
+            unmap();
+            throw std::runtime_error(std::string("Failed to map the io_uring: ") +
+                                     std::strerror(error));
+        }
+
+        return mapping;
+    };
+
+    d_sqRing = map(d_sqRingSize, IORING_OFF_SQ_RING);
+    d_cqRing = singleMapping ? d_sqRing : map(d_cqRingSize, IORING_OFF_CQ_RING);
+    d_sqes = map(d_sqesSize, IORING_OFF_SQES);
+
+    auto *sqRing = static_cast<Byte *>(d_sqRing);
+    d_sqHead = reinterpret_cast<unsigned int *>(sqRing + params.sq_off.head);
+    d_sqTail = reinterpret_cast<unsigned int *>(sqRing + params.sq_off.tail);
+    d_sqArray = reinterpret_cast<unsigned int *>(sqRing + params.sq_off.array);
+    d_sqMask = *reinterpret_cast<unsigned int *>(sqRing + params.sq_off.ring_mask);
+    d_numEntries = params.sq_entries;
+
+    auto *cqRing = static_cast<Byte *>(d_cqRing);
+    d_cqHead = reinterpret_cast<unsigned int *>(cqRing + params.cq_off.head);
+    d_cqTail = reinterpret_cast<unsigned int *>(cqRing + params.cq_off.tail);
+    d_cqes = cqRing + params.cq_off.cqes;
+    d_cqMask = *reinterpret_cast<unsigned int *>(cqRing + params.cq_off.ring_mask);
+#else
+    static_cast<void>(numEntries);
+    throw std::runtime_error("io_uring is only available on Linux");
+#endif
+}
+
+IoRing::~IoRing() { unmap(); }
+
+// PRIVATE MANIPULATORS
+void IoRing::unmap() {
+#if defined(QOI_HAVE_IO_URING)
+    if (d_sqes != nullptr) {
+        ::munmap(d_sqes, d_sqesSize);
+    }
+
+    if (d_cqRing != nullptr && d_cqRing != d_sqRing) {
+        ::munmap(d_cqRing, d_cqRingSize);
+    }
+
+    if (d_sqRing != nullptr) {
+        ::munmap(d_sqRing, d_sqRingSize);
+    }
+
+    if (d_fd >= 0) {
+        ::close(d_fd);
+    }
+#endif
+
+    d_sqes = d_cqRing = d_sqRing = nullptr;
+    d_fd = -1;
+}
+
+void IoRing::drain() {
+#if defined(QOI_HAVE_IO_URING)
+    // the kernel only looks at the queued entries when they are submitted, so they can be taken
+    // back by moving the tail
+    std::atomic_ref<unsigned int>(*d_sqTail).store(*d_sqTail - d_numQueued,
+                                                   std::memory_order_release);
+    d_numQueued = 0;
+
+    while (d_numInFlight > 0) {
+        const unsigned int head = *d_cqHead;
+        if (head != std::atomic_ref<unsigned int>(*d_cqTail).load(std::memory_order_acquire)) {
+            std::atomic_ref<unsigned int>(*d_cqHead).store(head + 1, std::memory_order_release);
+            --d_numInFlight;
+            continue;
+        }
+
+        if (::syscall(__NR_io_uring_enter, d_fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+            errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            // a transfer still in flight may land in its buffer whenever, nothing is safe anymore
+            std::terminate();
+        }
+    }
+#endif
+}
+
+void IoRing::queue(std::uint8_t opcode, int fd, const Byte *data, std::uint32_t length,
+                   std::uint64_t offset, std::uint64_t tag) {
+#if defined(QOI_HAVE_IO_URING)
+    if (!hasRoom()) {
+        throw std::runtime_error("The io_uring is full");
+    }
+
+    // only this thread moves the tail, the kernel moves the head
+    const unsigned int tail = *d_sqTail;
+    const unsigned int index = tail & d_sqMask;
+    auto *entry = static_cast<io_uring_sqe *>(d_sqes) + index;
+    std::memset(entry, 0, sizeof(*entry));
+    entry->opcode = opcode;
+    entry->fd = fd;
+    entry->addr = reinterpret_cast<std::uint64_t>(data);
+    entry->len = length;
+    entry->off = offset;
+    entry->user_data = tag;
+    d_sqArray[index] = index;
+
+    std::atomic_ref<unsigned int>(*d_sqTail).store(tail + 1, std::memory_order_release);
+    ++d_numQueued;
+#else
+    static_cast<void>(opcode);
+    static_cast<void>(fd);
+    static_cast<void>(data);
+    static_cast<void>(length);
+    static_cast<void>(offset);
+    static_cast<void>(tag);
+#endif
+}
+
+// MANIPULATORS
+void IoRing::queueRead(int fd, std::span<Byte> buffer, std::uint64_t offset, std::uint64_t tag) {
+#if defined(QOI_HAVE_IO_URING)
+    queue(IORING_OP_READ, fd, buffer.data(),
+          static_cast<std::uint32_t>(std::min(buffer.size(), MAX_TRANSFER_SIZE)), offset, tag);
+#endif
+}
+
+void IoRing::queueWrite(int fd, std::span<const Byte> bytes, std::uint64_t offset,
+                        std::uint64_t tag) {
+#if defined(QOI_HAVE_IO_URING)
+    queue(IORING_OP_WRITE, fd, bytes.data(),
+          static_cast<std::uint32_t>(std::min(bytes.size(), MAX_TRANSFER_SIZE)), offset, tag);
+#endif
+}
+
+IoRing::Completion IoRing::wait() {
+#if defined(QOI_HAVE_IO_URING)
+    while (true) {
+        // only this thread moves the head, the kernel moves the tail
+        const unsigned int head = *d_cqHead;
+        const bool ready =
+            head != std::atomic_ref<unsigned int>(*d_cqTail).load(std::memory_order_acquire);
+
+        if (ready && d_numQueued == 0) {
+            const auto &entry = static_cast<const io_uring_cqe *>(d_cqes)[head & d_cqMask];
+            const Completion completion{.d_tag = entry.user_data, .d_result = entry.res};
+            std::atomic_ref<unsigned int>(*d_cqHead).store(head + 1, std::memory_order_release);
+            --d_numInFlight;
+            return completion;
+        }
+
+        if (!ready && d_numQueued == 0 && d_numInFlight == 0) {
+            throw std::runtime_error("Nothing to wait for in the io_uring");
+        }
+
+        // submit what is queued, and wait for a result only if none is there yet
+        const long submitted = ::syscall(__NR_io_uring_enter, d_fd, d_numQueued, ready ? 0 : 1,
+                                         IORING_ENTER_GETEVENTS, nullptr, 0);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            const int error = errno;
+            drain();
+            throw std::runtime_error(std::string("io_uring submission failed: ") +
+                                     std::strerror(error));
+        }
+
+        d_numQueued -= static_cast<unsigned int>(submitted);
+        d_numInFlight += static_cast<unsigned int>(submitted);
+    }
+#else
+    throw std::runtime_error("io_uring is only available on Linux");
+#endif
+}
+
+// ACCESSORS
+bool IoRing::hasRoom() const { return d_numQueued + d_numInFlight < d_numEntries; }
+
+bool IoRing::isBusy() const { return d_numQueued + d_numInFlight > 0; }
+
+bool IoRing::isAvailable() {
+    try {
+        IoRing ring(1);
+        return true;
+    } catch (const std::exception &) {
+        return false;
+    }
+}
+
+auto readFiles(IoRing &ring, std::span<const std::filesystem::path> paths)
+    -> std::vector<FileRead> {
+    std::vector<FileRead> results(paths.size());
+#if defined(QOI_HAVE_IO_URING)
+    std::vector<FileDescriptor> fds;
+    std::vector<int> errors(paths.size(), 0);
+    std::vector<Transfer> transfers;
+
+    // every buffer is sized before any read is queued, so none of them moves while in flight
+    fds.reserve(paths.size());
+    for (std::size_t file = 0; file < paths.size(); ++file) {
+        const int fd = fds.emplace_back(::open(paths[file].c_str(), O_RDONLY | O_CLOEXEC)).get();
+        struct stat status{};
+        if (fd < 0 || ::fstat(fd, &status) != 0) {
+            errors[file] = errno;
+            continue;
+        }
+
+        results[file].d_bytes.resize(static_cast<std::size_t>(status.st_size));
+        splitTransfers(file, fd, results[file].d_bytes.data(), results[file].d_bytes.size(), 0,
+                       transfers);
+    }
+
+    runTransfers(ring, transfers, false, errors);
+
+    for (std::size_t file = 0; file < paths.size(); ++file) {
+        if (errors[file] != 0) {
+            results[file].d_bytes = {};
+            results[file].d_error =
+                "Failed to read file: " + paths[file].string() + ": " + std::strerror(errors[file]);
+        }
+    }
+#else
+    static_cast<void>(ring);
+#endif
+
+    return results;
+}
+
+auto writeFiles(IoRing &ring, std::span<const FileWrite> writes) -> std::vector<std::string> {
+    std::vector<std::string> results(writes.size());
+#if defined(QOI_HAVE_IO_URING)
+    std::vector<FileDescriptor> fds;
+    std::vector<int> errors(writes.size(), 0);
+    std::vector<Transfer> transfers;
+
+    fds.reserve(writes.size());
+    for (std::size_t file = 0; file < writes.size(); ++file) {
+        const int fd = fds.emplace_back(::open(writes[file].d_path.c_str(),
+                                               O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+                           .get();
+        if (fd < 0) {
+            errors[file] = errno;
+            continue;
+        }
+
+        // the kernel only reads the bytes of a write
+        std::uint64_t offset = 0;
+        for (const auto &piece : writes[file].d_pieces) {
+            splitTransfers(file, fd, const_cast<Byte *>(piece.data()), piece.size(), offset,
+                           transfers);
+            offset += piece.size();
+        }
+    }
+
+    runTransfers(ring, transfers, true, errors);
+
+    for (std::size_t file = 0; file < writes.size(); ++file) {
+        const int closeError = fds[file].close();
+        if (errors[file] == 0) {
+            errors[file] = closeError;
+        }
+
+        if (errors[file] != 0) {
+            results[file] = "Failed to write file: " + writes[file].d_path.string() + ": " +
+                            std::strerror(errors[file]);
+        }
+    }
+#else
+    static_cast<void>(ring);
+#endif
+
+    return results;
+}
+} // namespace qoi
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <qoi_types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+// The kernel interface is used directly through its system calls, so no library is needed beyond
+// the Linux headers.
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define QOI_HAVE_IO_URING 1
+#endif
+
+namespace qoi {
+// A Linux io_uring: reads and writes are queued in a ring shared with the kernel, submitted
+// together with one system call, and their results collected from a second ring. Many small
+// transfers then cost a few system calls instead of one each, and none of them blocks the thread
+// until it asks for a result.
+class IoRing {
+  public:
+    // TYPES
+    struct Completion {
+        std::uint64_t d_tag; // the tag the transfer was queued with
+        int d_result;        // bytes transferred, or minus the error number
+    };
+
+  private:
+    // DATA
+    int d_fd;
+    void *d_sqRing;
+    std::size_t d_sqRingSize;
+    void *d_cqRing;
+    std::size_t d_cqRingSize;
+    void *d_sqes;
+    std::size_t d_sqesSize;
+    unsigned int *d_sqHead;
+    unsigned int *d_sqTail;
+    unsigned int *d_sqArray;
+    unsigned int d_sqMask;
+    unsigned int d_numEntries;
+    unsigned int *d_cqHead;
+    unsigned int *d_cqTail;
+    void *d_cqes;
+    unsigned int d_cqMask;
+    unsigned int d_numQueued;   // transfers queued but not yet submitted
+    unsigned int d_numInFlight; // transfers submitted whose result has not been collected
+
+    // PRIVATE MANIPULATORS
+    void unmap();
+
+    // Drop the transfers not submitted yet and wait for every one in flight to finish, discarding
+    // its result, so that no buffer is used by the kernel anymore.
+    void drain();
+
+    void queue(std::uint8_t opcode, int fd, const Byte *data, std::uint32_t length,
+               std::uint64_t offset, std::uint64_t tag);
+
+  public:
+    // CREATORS
+
+    // Create a ring of at least 'numEntries' transfers. Throws if the kernel does not provide
+    // io_uring or refuses it, e.g. inside a sandbox.
+    explicit IoRing(unsigned int numEntries = 64);
+
+    IoRing(const IoRing &) = delete;
+
+    IoRing &operator=(const IoRing &) = delete;
+
+    ~IoRing();
+
+    // MANIPULATORS
+
+    // Queue a read of 'buffer.size()' bytes at 'offset' of the open file 'fd' into 'buffer'. The
+    // buffer must stay valid until the completion tagged 'tag' is collected.
+    void queueRead(int fd, std::span<Byte> buffer, std::uint64_t offset, std::uint64_t tag);
+
+    // Queue a write of 'bytes' at 'offset' of the open file 'fd'. The bytes must stay valid until
+    // the completion tagged 'tag' is collected.
+    void queueWrite(int fd, std::span<const Byte> bytes, std::uint64_t offset, std::uint64_t tag);
+
+    // Submit every queued transfer and return the result of one, waiting for it if none has
+    // finished. Throws if the kernel rejects the submission, once every transfer still in flight
+    // has finished and the ones not submitted are dropped, so their buffers may be freed.
+    Completion wait();
+
+    // ACCESSORS
+
+    // Return whether another transfer can be queued before collecting a result.
+    bool hasRoom() const;
+
+    // Return whether any transfer is queued or in flight.
+    bool isBusy() const;
+
+    // Return whether io_uring can be used on this system.
+    static bool isAvailable();
+};
+
+// The bytes of one whole file read through a ring, or why they could not be read.
+struct FileRead {
+    std::vector<Byte> d_bytes;
+    std::string d_error; // empty if the file was read
+};
+
+// One file to write through a ring: the concatenation of 'd_pieces'.
+struct FileWrite {
+    std::filesystem::path d_path;
+    std::vector<std::span<const Byte>> d_pieces;
+};
+
+// Read every file of 'paths' whole, keeping as many reads in flight in 'ring' as it holds.
+// Opening a file or reading it can fail for each file on its own, which is reported in its
+// result rather than thrown. Throws if the ring itself fails, with every file closed.
+auto readFiles(IoRing &ring, std::span<const std::filesystem::path> paths)
+    -> std::vector<FileRead>;
+
+// Create or replace every file of 'writes', keeping as many writes in flight in 'ring' as it
+// holds. Return one error message per file, empty if the file was written. Throws if the ring
+// itself fails, with every file closed.
+auto writeFiles(IoRing &ring, std::span<const FileWrite> writes) -> std::vector<std::string>;
+} // namespace qoi
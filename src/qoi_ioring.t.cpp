@@ -0,0 +1,54 @@
+#include <qoi_ioring.h>
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace qoi;
+
+TEST(IoRingTest, writesAndReadsBackManyFiles) {
+    if (!IoRing::isAvailable()) {
+        GTEST_SKIP() << "io_uring is not available";
+    }
+
+    const auto directory = std::filesystem::temp_directory_path() / "qoi_ioring_test";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory);
+
+    // more files than the ring holds, of different sizes, some written in two pieces
+    std::vector<std::vector<Byte>> contents;
+    std::vector<FileWrite> writes;
+    std::vector<std::filesystem::path> paths;
+    for (std::size_t file = 0; file < 20; ++file) {
+        contents.emplace_back(file * 997 + 1);
+        for (std::size_t byte = 0; byte < contents.back().size(); ++byte) {
+            contents.back()[byte] = static_cast<Byte>(byte * 31 + file);
+        }
+
+        const std::span<const Byte> bytes{contents.back()};
+        const auto half = bytes.size() / 2;
+        paths.push_back(directory / ("file" + std::to_string(file)));
+        writes.push_back({.d_path = paths.back(),
+                          .d_pieces = {bytes.first(half), bytes.subspan(half)}});
+    }
+
+    paths.push_back(directory / "missing");
+
+    IoRing ring(4);
+    for (const auto &error : writeFiles(ring, writes)) {
+        EXPECT_EQ(error, "");
+    }
+
+    const auto files = readFiles(ring, paths);
+    ASSERT_EQ(files.size(), paths.size());
+    for (std::size_t file = 0; file < contents.size(); ++file) {
+        EXPECT_EQ(files[file].d_error, "");
+        EXPECT_EQ(files[file].d_bytes, contents[file]);
+    }
+
+    EXPECT_NE(files.back().d_error, "");
+    EXPECT_FALSE(ring.isBusy());
+    std::filesystem::remove_all(directory);
+}
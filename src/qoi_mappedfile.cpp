@@ -0,0 +1,113 @@
+#include <qoi_mappedfile.h>
+
+#include <array>
+#include <cerrno>
+#include <fstream>
+#include <stdexcept>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define QOI_HAVE_MMAP 1
+#endif
+
+namespace qoi {
+// CREATORS
+MappedFile::MappedFile(const std::filesystem::path &filename, bool preload)
+    : d_data(nullptr), d_size(0), d_fallback() {
+#if defined(QOI_HAVE_MMAP)
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + filename.string());
+    }
+
+    struct stat status{};
+    if (::fstat(fd, &status) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Failed to read file size: " + filename.string());
+    }
+
+    if (S_ISREG(status.st_mode)) {
+        d_size = static_cast<std::size_t>(status.st_size);
+        if (d_size > 0) {
+            int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+            if (preload) {
+                flags |= MAP_POPULATE;
+            }
+#endif
+
+            void *mapping = ::mmap(nullptr, d_size, PROT_READ, flags, fd, 0);
+            if (mapping == MAP_FAILED) {
+                ::close(fd);
+                throw std::runtime_error("Failed to map file: " + filename.string());
+            }
+
+            // the codecs walk the file front to back exactly once
+            ::madvise(mapping, d_size, MADV_SEQUENTIAL);
+            d_data = static_cast<const Byte *>(mapping);
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        ::close(fd);
+        return;
+    }
+
+    // pipes and devices cannot be mapped and have no size up front, so they are read to the end
+    // through the descriptor already open: opening a pipe again could miss what was written to it
+    std::array<Byte, 1 << 16> chunk;
+    for (;;) {
+        const ::ssize_t count = ::read(fd, chunk.data(), chunk.size());
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (count < 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to read file: " + filename.string());
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        d_fallback.insert(d_fallback.end(), chunk.begin(), chunk.begin() + count);
+    }
+
+    ::close(fd);
+#else
+    // without mmap every file is read into memory once
+    static_cast<void>(preload);
+    std::ifstream file{filename, std::ios::binary};
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filename.string());
+    }
+
+    std::array<char, 1 << 16> chunk;
+    while (file.read(chunk.data(), chunk.size()) || file.gcount() > 0) {
+        d_fallback.insert(d_fallback.end(), chunk.begin(), chunk.begin() + file.gcount());
+    }
+
+    if (file.bad()) {
+        throw std::runtime_error("Failed to read file: " + filename.string());
+    }
+#endif
+
+    d_data = d_fallback.data();
+    d_size = d_fallback.size();
+}
+
+MappedFile::~MappedFile() {
+#if defined(QOI_HAVE_MMAP)
+    // a file that was read rather than mapped lives in 'd_fallback'
+    if (d_data && d_data != d_fallback.data()) {
+        ::munmap(const_cast<Byte *>(d_data), d_size);
+    }
+#endif
+}
+
+// ACCESSORS
+std::span<const Byte> MappedFile::bytes() const { return {d_data, d_size}; }
+} // namespace qoi
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <qoi_types.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+namespace qoi {
+// A read-only view of a whole file. A regular file is memory mapped where the platform supports it,
+// so its bytes are paged in on demand and never copied; elsewhere, and for pipes and devices such
+// as standard input, the file is read into memory once.
+class MappedFile {
+    // DATA
+    const Byte *d_data;
+    std::size_t d_size;
+    std::vector<Byte> d_fallback;
+
+  public:
+    // CREATORS
+
+    // Map 'filename'. With 'preload', every page is read in here rather than on first access, so
+    // a thread that only does I/O can take the disk latency off the thread that uses the bytes.
+    explicit MappedFile(const std::filesystem::path &filename, bool preload = false);
+
+    MappedFile(const MappedFile &) = delete;
+
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile();
+
+    // ACCESSORS
+    std::span<const Byte> bytes() const;
+};
+} // namespace qoi
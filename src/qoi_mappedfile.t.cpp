@@ -0,0 +1,53 @@
+#include <qoi_mappedfile.h>
+#include <qoi_types.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#if __has_include(<sys/stat.h>)
+#include <sys/stat.h>
+#endif
+
+using namespace qoi;
+
+namespace {
+auto equals(std::span<const Byte> bytes, const std::string &text) -> bool {
+    return std::equal(bytes.begin(), bytes.end(), text.begin(), text.end(),
+                      [](Byte lhs, char rhs) { return lhs == static_cast<Byte>(rhs); });
+}
+} // namespace
+
+TEST(MappedFileTest, viewsTheWholeFile) {
+    const auto path = std::filesystem::temp_directory_path() / "qoi_mappedfile_test_regular";
+    const std::string text(100000, 'q');
+    std::ofstream(path, std::ios::binary) << text;
+
+    EXPECT_TRUE(equals(MappedFile(path).bytes(), text));
+    EXPECT_TRUE(equals(MappedFile(path, true).bytes(), text));
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc);
+    EXPECT_TRUE(MappedFile(path).bytes().empty());
+    std::filesystem::remove(path);
+}
+
+TEST(MappedFileTest, readsAPipeToItsEnd) {
+#if __has_include(<sys/stat.h>)
+    const auto path = std::filesystem::temp_directory_path() / "qoi_mappedfile_test_fifo";
+    std::filesystem::remove(path);
+    ASSERT_EQ(::mkfifo(path.c_str(), 0600), 0);
+
+    // a pipe has no size, so more than one read's worth must still arrive whole
+    const std::string text(200000, 'p');
+    std::jthread writer([&] { std::ofstream(path, std::ios::binary) << text; });
+    EXPECT_TRUE(equals(MappedFile(path).bytes(), text));
+    writer.join();
+    std::filesystem::remove(path);
+#else
+    GTEST_SKIP() << "named pipes are not available";
+#endif
+}
@@ -0,0 +1,53 @@
+#include <qoi_memorybudget.h>
+
+namespace qoi {
+// CREATORS
+MemoryBudget::MemoryBudget(std::uint64_t limit)
+    : d_mutex(), d_changed(), d_limit(limit), d_used(0), d_nextTicket(0), d_nowServing(0) {}
+
+// MANIPULATORS
+void MemoryBudget::acquire(std::uint64_t bytes) {
+    std::unique_lock lock(d_mutex);
+    const std::uint64_t ticket = d_nextTicket++;
+    d_changed.wait(lock, [&] {
+        return ticket == d_nowServing &&
+               (d_limit == 0 || d_used == 0 || d_used + bytes <= d_limit);
+    });
+
+    d_used += bytes;
+    ++d_nowServing;
+    lock.unlock();
+
+    // the next ticket may fit as well
+    d_changed.notify_all();
+}
+
+bool MemoryBudget::tryAcquire(std::uint64_t bytes) {
+    const std::lock_guard lock(d_mutex);
+    if (d_nextTicket != d_nowServing ||
+        (d_limit != 0 && d_used != 0 && d_used + bytes > d_limit)) {
+        return false;
+    }
+
+    // taking and serving a ticket at once keeps the order of the waiting reservations
+    ++d_nextTicket;
+    ++d_nowServing;
+    d_used += bytes;
+    return true;
+}
+
+void MemoryBudget::release(std::uint64_t bytes) {
+    {
+        const std::lock_guard lock(d_mutex);
+        d_used -= bytes;
+    }
+
+    d_changed.notify_all();
+}
+
+// ACCESSORS
+std::uint64_t MemoryBudget::used() const {
+    const std::lock_guard lock(d_mutex);
+    return d_used;
+}
+} // namespace qoi
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+namespace qoi {
+// Admits work against a fixed number of bytes. Each piece of work reserves its estimated peak
+// memory before it starts and gives it back when it is done, and a reservation that does not fit
+// waits until enough has been given back. Reservations are granted in the order they are asked
+// for, so a large one is not starved by a stream of small ones, and one larger than the whole
+// budget is granted once nothing else is reserved, so that it still runs, alone.
+class MemoryBudget {
+    // DATA
+    mutable std::mutex d_mutex;
+    std::condition_variable d_changed;
+    std::uint64_t d_limit;
+    std::uint64_t d_used;
+    std::uint64_t d_nextTicket;
+    std::uint64_t d_nowServing;
+
+  public:
+    // CREATORS
+
+    // Create a budget of 'limit' bytes, or an unlimited one if 'limit' is 0.
+    explicit MemoryBudget(std::uint64_t limit);
+
+    MemoryBudget(const MemoryBudget &) = delete;
+
+    MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+    // MANIPULATORS
+
+    // Reserve 'bytes', waiting until every earlier reservation is granted and 'bytes' fits.
+    void acquire(std::uint64_t bytes);
+
+    // Reserve 'bytes' only if that needs no waiting, and return whether it was reserved.
+    bool tryAcquire(std::uint64_t bytes);
+
+    // Give back 'bytes' reserved by 'acquire' or 'tryAcquire'.
+    void release(std::uint64_t bytes);
+
+    // ACCESSORS
+
+    // Return the number of bytes currently reserved.
+    std::uint64_t used() const;
+};
+} // namespace qoi
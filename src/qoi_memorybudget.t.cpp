@@ -0,0 +1,48 @@
+#include <qoi_memorybudget.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace qoi;
+
+TEST(MemoryBudgetTest, waitsUntilReservationFits) {
+    MemoryBudget budget(100);
+    budget.acquire(60);
+
+    std::atomic<bool> granted = false;
+    std::jthread waiter([&] {
+        budget.acquire(50);
+        granted = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_FALSE(granted);
+
+    budget.release(60);
+    waiter.join();
+    EXPECT_TRUE(granted);
+    EXPECT_EQ(budget.used(), 50u);
+}
+
+TEST(MemoryBudgetTest, tryAcquireNeverWaits) {
+    MemoryBudget budget(100);
+    EXPECT_TRUE(budget.tryAcquire(70));
+    EXPECT_FALSE(budget.tryAcquire(40));
+    EXPECT_TRUE(budget.tryAcquire(30));
+    EXPECT_EQ(budget.used(), 100u);
+}
+
+TEST(MemoryBudgetTest, grantsOversizedReservationAlone) {
+    MemoryBudget budget(100);
+    budget.acquire(500);
+    EXPECT_EQ(budget.used(), 500u);
+    budget.release(500);
+
+    MemoryBudget unlimited(0);
+    unlimited.acquire(500);
+    unlimited.acquire(500);
+    EXPECT_EQ(unlimited.used(), 1000u);
+}
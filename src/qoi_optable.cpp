@@ -0,0 +1 @@
+#include <qoi_optable.h>
\ No newline at end of file
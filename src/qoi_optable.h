@@ -0,0 +1,94 @@
+#pragma once
+
+#include <qoi_constants.h>
+#include <qoi_types.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace qoi {
+enum class OpKind : std::uint8_t { RGBA, RGB, INDEX, DIFF, LUMA, RUN };
+
+// Everything that can be known about an op from its tag byte alone.
+struct OpInfo {
+    OpKind d_kind;
+    std::uint8_t d_length; // bytes taken by the op, tag included
+    std::uint8_t d_value;  // INDEX: cache slot, RUN: number of pixels
+    std::int8_t d_dr;      // DIFF: red delta, LUMA: green delta - 8
+    std::int8_t d_dg;      // DIFF: green delta, LUMA: green delta
+    std::int8_t d_db;      // DIFF: blue delta, LUMA: green delta - 8
+};
+
+constexpr auto makeOpInfo(Byte tag) -> OpInfo {
+    constexpr Byte TAG_MASK = 0xC0;
+    constexpr Byte DIFF_MASK = 0x03;
+    constexpr Byte GREEN_DIFF_MASK = 0x3F;
+    constexpr Byte RUN_MASK = 0x3F;
+
+    // the 8-bit RGB and RGBA tags take precedence over the 2-bit run tag they share bits with
+    if (tag == QOI_OP_RGBA) {
+        return {.d_kind = OpKind::RGBA,
+                .d_length = 5,
+                .d_value = 0,
+                .d_dr = 0,
+                .d_dg = 0,
+                .d_db = 0};
+    }
+
+    if (tag == QOI_OP_RGB) {
+        return {.d_kind = OpKind::RGB,
+                .d_length = 4,
+                .d_value = 0,
+                .d_dr = 0,
+                .d_dg = 0,
+                .d_db = 0};
+    }
+
+    switch (tag & TAG_MASK) {
+    case QOI_OP_INDEX:
+        return {.d_kind = OpKind::INDEX,
+                .d_length = 1,
+                .d_value = tag,
+                .d_dr = 0,
+                .d_dg = 0,
+                .d_db = 0};
+    case QOI_OP_DIFF:
+        return {.d_kind = OpKind::DIFF,
+                .d_length = 1,
+                .d_value = 0,
+                .d_dr = static_cast<std::int8_t>(((tag >> 4) & DIFF_MASK) - 2),
+                .d_dg = static_cast<std::int8_t>(((tag >> 2) & DIFF_MASK) - 2),
+                .d_db = static_cast<std::int8_t>((tag & DIFF_MASK) - 2)};
+    case QOI_OP_LUMA: {
+        // red and blue also move by the green delta; the second byte adds dr_dg + 8 and db_dg + 8
+        const auto dg = static_cast<std::int8_t>((tag & GREEN_DIFF_MASK) - 32);
+        return {.d_kind = OpKind::LUMA,
+                .d_length = 2,
+                .d_value = 0,
+                .d_dr = static_cast<std::int8_t>(dg - 8),
+                .d_dg = dg,
+                .d_db = static_cast<std::int8_t>(dg - 8)};
+    }
+    default:
+        return {.d_kind = OpKind::RUN,
+                .d_length = 1,
+                .d_value = static_cast<std::uint8_t>((tag & RUN_MASK) + 1),
+                .d_dr = 0,
+                .d_dg = 0,
+                .d_db = 0};
+    }
+}
+
+constexpr auto makeOpTable() -> std::array<OpInfo, 256> {
+    std::array<OpInfo, 256> table{};
+    for (std::size_t tag = 0; tag < table.size(); ++tag) {
+        table[tag] = makeOpInfo(static_cast<Byte>(tag));
+    }
+
+    return table;
+}
+
+// Decoding information for every possible tag byte.
+constexpr std::array<OpInfo, 256> QOI_OP_TABLE = makeOpTable();
+} // namespace qoi
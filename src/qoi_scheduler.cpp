@@ -0,0 +1,24 @@
+#include <qoi_scheduler.h>
+
+#include <algorithm>
+#include <numeric>
+
+namespace qoi {
+// CREATORS
+JobScheduler::JobScheduler(std::span<const std::uint64_t> costs)
+    : d_order(costs.size()), d_next(0) {
+    std::iota(d_order.begin(), d_order.end(), 0);
+    std::stable_sort(d_order.begin(), d_order.end(),
+                     [&](std::size_t lhs, std::size_t rhs) { return costs[lhs] > costs[rhs]; });
+}
+
+// MANIPULATORS
+std::optional<std::size_t> JobScheduler::next() {
+    const std::size_t position = d_next.fetch_add(1, std::memory_order_relaxed);
+    if (position >= d_order.size()) {
+        return std::nullopt;
+    }
+
+    return d_order[position];
+}
+} // namespace qoi
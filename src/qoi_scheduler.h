@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace qoi {
+// Hands out jobs of known cost largest first, so that the giant jobs start early and the small
+// ones fill in at the end. Every caller takes the next job of one shared order, which costs a
+// single atomic increment.
+class JobScheduler {
+    // DATA
+    std::vector<std::size_t> d_order; // indices into the costs, costliest first
+    std::atomic<std::size_t> d_next;  // position in 'd_order' of the next job to hand out
+
+  public:
+    // CREATORS
+
+    // Create a scheduler over the jobs whose costs are 'costs', identified by their index in
+    // 'costs'. Jobs of the same cost keep their order.
+    explicit JobScheduler(std::span<const std::uint64_t> costs);
+
+    // MANIPULATORS
+
+    // Return the next job, or nothing once every job has been handed out. Safe to call from
+    // several threads at once.
+    std::optional<std::size_t> next();
+};
+} // namespace qoi
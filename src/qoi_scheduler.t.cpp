@@ -0,0 +1,48 @@
+#include <qoi_scheduler.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace qoi;
+
+TEST(JobSchedulerTest, handsOutCostliestJobsFirst) {
+    const std::vector<std::uint64_t> costs = {5, 400, 0, 7000, 20, 400};
+    JobScheduler scheduler(costs);
+
+    std::vector<std::size_t> order;
+    while (const auto job = scheduler.next()) {
+        order.push_back(*job);
+    }
+
+    EXPECT_EQ(order, (std::vector<std::size_t>{3, 1, 5, 4, 0, 2}));
+}
+
+TEST(JobSchedulerTest, everyJobRunsExactlyOnce) {
+    const std::size_t numJobs = 1000;
+    std::vector<std::uint64_t> costs(numJobs);
+    for (std::size_t job = 0; job < numJobs; ++job) {
+        costs[job] = (job * 7919) % 97;
+    }
+
+    JobScheduler scheduler(costs);
+    std::vector<int> runs(numJobs, 0);
+    std::mutex runsMutex;
+    {
+        std::vector<std::jthread> workers;
+        for (unsigned int worker = 0; worker < 8; ++worker) {
+            workers.emplace_back([&] {
+                while (const auto job = scheduler.next()) {
+                    const std::lock_guard lock(runsMutex);
+                    ++runs[*job];
+                }
+            });
+        }
+    }
+
+    EXPECT_EQ(runs, std::vector<int>(numJobs, 1));
+}
@@ -0,0 +1,408 @@
+#include <qoi_simd.h>
+
+#include <qoi_cpu.h>
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(QOI_HAVE_X86_DISPATCH)
+#include <immintrin.h>
+#define QOI_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+namespace qoi {
+namespace {
+// SCALAR
+auto matchRunLength3Scalar(const Byte *bytes, std::size_t numPixels, const Pixel &pixel)
+    -> std::size_t {
+    std::size_t count = 0;
+    for (; count < numPixels; ++count) {
+        const Byte *curr = bytes + count * 3;
+        if (curr[0] != pixel.d_red || curr[1] != pixel.d_green || curr[2] != pixel.d_blue) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+auto matchRunLength4Scalar(const Byte *bytes, std::size_t numPixels, const Pixel &pixel)
+    -> std::size_t {
+    const std::uint32_t value = pixel.packed();
+
+    std::size_t count = 0;
+    for (; count < numPixels; ++count) {
+        std::uint32_t curr;
+        std::memcpy(&curr, bytes + count * 4, sizeof(curr));
+        if (curr != value) {
+            break;
+        }
+    }
+
+    return count;
+}
+
+auto fillRun3Scalar(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    for (std::size_t count = 0; count < numPixels; ++count) {
+        std::memcpy(output + count * 3, &pixel, 3);
+    }
+
+    return output + numPixels * 3;
+}
+
+auto fillRun4Scalar(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    for (std::size_t count = 0; count < numPixels; ++count) {
+        std::memcpy(output + count * 4, &pixel, 4);
+    }
+
+    return output + numPixels * 4;
+}
+
+auto expandRgbToRgbaScalar(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    for (std::size_t count = 0; count < numPixels; ++count) {
+        std::memcpy(output + count * 4, input + count * 3, 3);
+        output[count * 4 + 3] = 255;
+    }
+}
+
+auto compactRgbaToRgbScalar(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    for (std::size_t count = 0; count < numPixels; ++count) {
+        std::memcpy(output + count * 3, input + count * 4, 3);
+    }
+}
+
+#if defined(QOI_HAVE_X86_DISPATCH)
+// SSE2
+QOI_TARGET("sse2")
+auto matchRunLength3Sse2(const Byte *bytes, std::size_t numPixels, const Pixel &pixel)
+    -> std::size_t {
+    // 16 RGB pixels span exactly three 16 byte registers
+    std::array<Byte, 48> pattern;
+    for (std::size_t iter = 0; iter < pattern.size(); iter += 3) {
+        pattern[iter] = pixel.d_red;
+        pattern[iter + 1] = pixel.d_green;
+        pattern[iter + 2] = pixel.d_blue;
+    }
+
+    const __m128i pattern0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pattern[0]));
+    const __m128i pattern1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pattern[16]));
+    const __m128i pattern2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pattern[32]));
+
+    std::size_t count = 0;
+    for (; count + 16 <= numPixels; count += 16) {
+        const Byte *block = bytes + count * 3;
+        const auto data0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+        const auto data1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 16));
+        const auto data2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + 32));
+
+        const std::uint64_t mask =
+            static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data0, pattern0))) |
+            (static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data1, pattern1)))
+             << 16) |
+            (static_cast<std::uint64_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(data2, pattern2)))
+             << 32);
+
+        if (mask != 0xFFFFFFFFFFFF) {
+            return count + std::countr_one(mask) / 3;
+        }
+    }
+
+    return count + matchRunLength3Scalar(bytes + count * 3, numPixels - count, pixel);
+}
+
+QOI_TARGET("sse2")
+auto matchRunLength4Sse2(const Byte *bytes, std::size_t numPixels, const Pixel &pixel)
+    -> std::size_t {
+    const __m128i narrow = _mm_set1_epi32(static_cast<int>(pixel.packed()));
+
+    std::size_t count = 0;
+    for (; count + 4 <= numPixels; count += 4) {
+        const auto data = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bytes + count * 4));
+        const auto mask = static_cast<std::uint32_t>(
+            _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(data, narrow))));
+        if (mask != 0xF) {
+            return count + std::countr_one(mask);
+        }
+    }
+
+    return count + matchRunLength4Scalar(bytes + count * 4, numPixels - count, pixel);
+}
+
+QOI_TARGET("sse2")
+auto fillRun3Sse2(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    std::size_t count = 0;
+    if (numPixels >= 16) {
+        std::array<Byte, 48> pattern;
+        for (std::size_t iter = 0; iter < pattern.size(); iter += 3) {
+            std::memcpy(&pattern[iter], &pixel, 3);
+        }
+
+        const __m128i pattern0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pattern[0]));
+        const __m128i pattern1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pattern[16]));
+        const __m128i pattern2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&pattern[32]));
+
+        for (; count + 16 <= numPixels; count += 16) {
+            Byte *block = output + count * 3;
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block), pattern0);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 16), pattern1);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block + 32), pattern2);
+        }
+    }
+
+    return fillRun3Scalar(output + count * 3, numPixels - count, pixel);
+}
+
+QOI_TARGET("sse2")
+auto fillRun4Sse2(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    const __m128i narrow = _mm_set1_epi32(static_cast<int>(pixel.packed()));
+
+    std::size_t count = 0;
+    for (; count + 4 <= numPixels; count += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + count * 4), narrow);
+    }
+
+    return fillRun4Scalar(output + count * 4, numPixels - count, pixel);
+}
+
+// SSSE3
+QOI_TARGET("ssse3")
+auto expandRgbToRgbaSsse3(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    // spread each 12 byte group of 4 RGB pixels over 16 bytes, then set the alpha bytes
+    const __m128i spread = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+
+    std::size_t count = 0;
+    for (; count + 16 <= numPixels; count += 16) {
+        const Byte *in = input + count * 3;
+        const auto data0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+        const auto data1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 16));
+        const auto data2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + 32));
+
+        // the groups start at bytes 0, 12, 24 and 36 of the 48 loaded
+        const auto group0 = data0;
+        const auto group1 = _mm_alignr_epi8(data1, data0, 12);
+        const auto group2 = _mm_alignr_epi8(data2, data1, 8);
+        const auto group3 = _mm_srli_si128(data2, 4);
+
+        auto *out = reinterpret_cast<__m128i *>(output + count * 4);
+        _mm_storeu_si128(out, _mm_or_si128(_mm_shuffle_epi8(group0, spread), alpha));
+        _mm_storeu_si128(out + 1, _mm_or_si128(_mm_shuffle_epi8(group1, spread), alpha));
+        _mm_storeu_si128(out + 2, _mm_or_si128(_mm_shuffle_epi8(group2, spread), alpha));
+        _mm_storeu_si128(out + 3, _mm_or_si128(_mm_shuffle_epi8(group3, spread), alpha));
+    }
+
+    expandRgbToRgbaScalar(input + count * 3, numPixels - count, output + count * 4);
+}
+
+QOI_TARGET("ssse3")
+auto compactRgbaToRgbSsse3(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    // pack each group of 4 RGBA pixels into its low 12 bytes, then stitch 4 groups into 48 bytes
+    const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    std::size_t count = 0;
+    for (; count + 16 <= numPixels; count += 16) {
+        const auto *in = reinterpret_cast<const __m128i *>(input + count * 4);
+        const auto group0 = _mm_shuffle_epi8(_mm_loadu_si128(in), pack);
+        const auto group1 = _mm_shuffle_epi8(_mm_loadu_si128(in + 1), pack);
+        const auto group2 = _mm_shuffle_epi8(_mm_loadu_si128(in + 2), pack);
+        const auto group3 = _mm_shuffle_epi8(_mm_loadu_si128(in + 3), pack);
+
+        auto *out = reinterpret_cast<__m128i *>(output + count * 3);
+        _mm_storeu_si128(out, _mm_or_si128(group0, _mm_slli_si128(group1, 12)));
+        _mm_storeu_si128(out + 1,
+                         _mm_or_si128(_mm_srli_si128(group1, 4), _mm_slli_si128(group2, 8)));
+        _mm_storeu_si128(out + 2,
+                         _mm_or_si128(_mm_srli_si128(group2, 8), _mm_slli_si128(group3, 4)));
+    }
+
+    compactRgbaToRgbScalar(input + count * 4, numPixels - count, output + count * 3);
+}
+
+// AVX2
+QOI_TARGET("avx2")
+auto matchRunLength4Avx2(const Byte *bytes, std::size_t numPixels, const Pixel &pixel)
+    -> std::size_t {
+    const __m256i wide = _mm256_set1_epi32(static_cast<int>(pixel.packed()));
+
+    std::size_t count = 0;
+    for (; count + 8 <= numPixels; count += 8) {
+        const auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bytes + count * 4));
+        const auto mask = static_cast<std::uint32_t>(
+            _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(data, wide))));
+        if (mask != 0xFF) {
+            return count + std::countr_one(mask);
+        }
+    }
+
+    return count + matchRunLength4Sse2(bytes + count * 4, numPixels - count, pixel);
+}
+
+QOI_TARGET("avx2")
+auto fillRun4Avx2(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    const __m256i wide = _mm256_set1_epi32(static_cast<int>(pixel.packed()));
+
+    std::size_t count = 0;
+    for (; count + 8 <= numPixels; count += 8) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + count * 4), wide);
+    }
+
+    return fillRun4Sse2(output + count * 4, numPixels - count, pixel);
+}
+
+QOI_TARGET("avx2")
+auto expandRgbToRgbaAvx2(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    // move the second 12 byte group of 8 RGB pixels into the upper lane, then spread both lanes
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    const __m256i spread = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+
+    // each iteration loads 32 bytes but converts only the first 24
+    std::size_t count = 0;
+    for (; count + 11 <= numPixels; count += 8) {
+        const auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + count * 3));
+        const auto groups = _mm256_permutevar8x32_epi32(data, lanes);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(output + count * 4),
+                            _mm256_or_si256(_mm256_shuffle_epi8(groups, spread), alpha));
+    }
+
+    expandRgbToRgbaSsse3(input + count * 3, numPixels - count, output + count * 4);
+}
+
+QOI_TARGET("avx2")
+auto compactRgbaToRgbAvx2(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    // pack each lane of 4 RGBA pixels into its low 12 bytes, then join the lanes into 24 bytes
+    const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+
+    std::size_t count = 0;
+    for (; count + 8 <= numPixels; count += 8) {
+        const auto data = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(input + count * 4));
+        const auto packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(data, pack), lanes);
+
+        Byte *out = output + count * 3;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm256_castsi256_si128(packed));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + 16),
+                         _mm256_extracti128_si256(packed, 1));
+    }
+
+    compactRgbaToRgbSsse3(input + count * 4, numPixels - count, output + count * 3);
+}
+
+// AVX512
+QOI_TARGET("avx512f")
+auto matchRunLength4Avx512(const Byte *bytes, std::size_t numPixels, const Pixel &pixel)
+    -> std::size_t {
+    const __m512i wide = _mm512_set1_epi32(static_cast<int>(pixel.packed()));
+
+    std::size_t count = 0;
+    for (; count + 16 <= numPixels; count += 16) {
+        const auto data = _mm512_loadu_si512(bytes + count * 4);
+        const auto mask = static_cast<std::uint32_t>(_mm512_cmpeq_epi32_mask(data, wide));
+        if (mask != 0xFFFF) {
+            return count + std::countr_one(mask);
+        }
+    }
+
+    return count + matchRunLength4Avx2(bytes + count * 4, numPixels - count, pixel);
+}
+
+QOI_TARGET("avx512f")
+auto fillRun4Avx512(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    const __m512i wide = _mm512_set1_epi32(static_cast<int>(pixel.packed()));
+
+    std::size_t count = 0;
+    for (; count + 16 <= numPixels; count += 16) {
+        _mm512_storeu_si512(output + count * 4, wide);
+    }
+
+    return fillRun4Avx2(output + count * 4, numPixels - count, pixel);
+}
+#endif
+
+// The kernels bound for one instruction set level.
+struct Kernels {
+    std::size_t (*d_matchRunLength3)(const Byte *, std::size_t, const Pixel &);
+    std::size_t (*d_matchRunLength4)(const Byte *, std::size_t, const Pixel &);
+    Byte *(*d_fillRun3)(Byte *, std::size_t, const Pixel &);
+    Byte *(*d_fillRun4)(Byte *, std::size_t, const Pixel &);
+    void (*d_expandRgbToRgba)(const Byte *, std::size_t, Byte *);
+    void (*d_compactRgbaToRgb)(const Byte *, std::size_t, Byte *);
+};
+
+constexpr Kernels SCALAR_KERNELS = {matchRunLength3Scalar, matchRunLength4Scalar,
+                                    fillRun3Scalar,        fillRun4Scalar,
+                                    expandRgbToRgbaScalar, compactRgbaToRgbScalar};
+
+#if defined(QOI_HAVE_X86_DISPATCH)
+// the channel shuffles need SSSE3, the run kernels gain nothing from it
+constexpr Kernels SSE2_KERNELS = {matchRunLength3Sse2,   matchRunLength4Sse2,
+                                  fillRun3Sse2,          fillRun4Sse2,
+                                  expandRgbToRgbaScalar, compactRgbaToRgbScalar};
+constexpr Kernels SSSE3_KERNELS = {matchRunLength3Sse2,  matchRunLength4Sse2,
+                                   fillRun3Sse2,         fillRun4Sse2,
+                                   expandRgbToRgbaSsse3, compactRgbaToRgbSsse3};
+constexpr Kernels AVX2_KERNELS = {matchRunLength3Sse2, matchRunLength4Avx2,
+                                  fillRun3Sse2,        fillRun4Avx2,
+                                  expandRgbToRgbaAvx2, compactRgbaToRgbAvx2};
+constexpr Kernels AVX512_KERNELS = {matchRunLength3Sse2, matchRunLength4Avx512,
+                                    fillRun3Sse2,        fillRun4Avx512,
+                                    expandRgbToRgbaAvx2, compactRgbaToRgbAvx2};
+
+// indexed by IsaLevel
+constexpr std::array<Kernels, 5> KERNELS = {SCALAR_KERNELS, SSE2_KERNELS, SSSE3_KERNELS,
+                                            AVX2_KERNELS, AVX512_KERNELS};
+#else
+constexpr std::array<Kernels, 5> KERNELS = {SCALAR_KERNELS, SCALAR_KERNELS, SCALAR_KERNELS,
+                                            SCALAR_KERNELS, SCALAR_KERNELS};
+#endif
+
+// The kernels of 'activeIsaLevel()'. They are scalar until the initializer below has run, so a
+// codec called during static initialization still works.
+constinit const Kernels *activeKernels = &SCALAR_KERNELS;
+
+const bool kernelsSelected = (selectKernels(activeIsaLevel()), true);
+
+auto kernels() -> const Kernels & { return *activeKernels; }
+} // namespace
+
+void selectKernels(IsaLevel level) { activeKernels = &KERNELS[static_cast<std::size_t>(level)]; }
+
+template <Channel CHANNELS>
+auto matchRunLength(const Byte *bytes, std::size_t numPixels, const Pixel &pixel) -> std::size_t {
+    static_assert(CHANNELS == 3 || CHANNELS == 4, "support only 3 or 4 channels");
+
+    if constexpr (CHANNELS == 4) {
+        return kernels().d_matchRunLength4(bytes, numPixels, pixel);
+    } else {
+        return kernels().d_matchRunLength3(bytes, numPixels, pixel);
+    }
+}
+
+template auto matchRunLength<3>(const Byte *, std::size_t, const Pixel &) -> std::size_t;
+template auto matchRunLength<4>(const Byte *, std::size_t, const Pixel &) -> std::size_t;
+
+template <Channel CHANNELS>
+auto fillRun(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte * {
+    static_assert(CHANNELS == 3 || CHANNELS == 4, "support only 3 or 4 channels");
+
+    if constexpr (CHANNELS == 4) {
+        return kernels().d_fillRun4(output, numPixels, pixel);
+    } else {
+        return kernels().d_fillRun3(output, numPixels, pixel);
+    }
+}
+
+template auto fillRun<3>(Byte *, std::size_t, const Pixel &) -> Byte *;
+template auto fillRun<4>(Byte *, std::size_t, const Pixel &) -> Byte *;
+auto expandRgbToRgba(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    kernels().d_expandRgbToRgba(input, numPixels, output);
+}
+
+auto compactRgbaToRgb(const Byte *input, std::size_t numPixels, Byte *output) -> void {
+    kernels().d_compactRgbaToRgb(input, numPixels, output);
+}
+} // namespace qoi
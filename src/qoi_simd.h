@@ -0,0 +1,42 @@
+#pragma once
+
+#include <qoi_cpu.h>
+#include <qoi_types.h>
+
+#include <cstddef>
+
+namespace qoi {
+// Dispatch every kernel below to its variant for 'level' from now on. The kernels of the level
+// active at startup are picked once before 'main', and 'setIsaLevel' calls this to swap them, so
+// a kernel call costs one load of a function pointer and no check.
+void selectKernels(IsaLevel level);
+
+// Return the number of leading pixels, out of the 'numPixels' interleaved pixels of 'CHANNELS'
+// bytes each starting at 'bytes', that are equal to 'pixel'. For 3 channels only the colour bytes
+// are compared. Compares several pixels per instruction on SSE2, AVX2 and AVX-512 CPUs, with
+// the variant for 'activeIsaLevel()'.
+template <Channel CHANNELS>
+auto matchRunLength(const Byte *bytes, std::size_t numPixels, const Pixel &pixel) -> std::size_t;
+
+extern template auto matchRunLength<3>(const Byte *, std::size_t, const Pixel &) -> std::size_t;
+extern template auto matchRunLength<4>(const Byte *, std::size_t, const Pixel &) -> std::size_t;
+
+// Write 'numPixels' copies of 'pixel' as interleaved pixels of 'CHANNELS' bytes each starting at
+// 'output' and return the end of the written range. Uses wide stores of the broadcast pixel on
+// SSE2, AVX2 and AVX-512 CPUs, with the variant for 'activeIsaLevel()'.
+template <Channel CHANNELS>
+auto fillRun(Byte *output, std::size_t numPixels, const Pixel &pixel) -> Byte *;
+
+extern template auto fillRun<3>(Byte *, std::size_t, const Pixel &) -> Byte *;
+extern template auto fillRun<4>(Byte *, std::size_t, const Pixel &) -> Byte *;
+
+// Write the 'numPixels' interleaved RGB pixels at 'input' to 'output' as RGBA pixels with an
+// alpha of 255. 'output' must have room for 'numPixels' * 4 bytes. Moves whole registers of pixels
+// with byte shuffles on SSSE3 and AVX2 CPUs, with the variant for 'activeIsaLevel()'.
+auto expandRgbToRgba(const Byte *input, std::size_t numPixels, Byte *output) -> void;
+
+// Write the 'numPixels' interleaved RGBA pixels at 'input' to 'output' as RGB pixels, dropping
+// alpha. 'output' must have room for 'numPixels' * 3 bytes. Uses byte shuffles like
+// 'expandRgbToRgba'.
+auto compactRgbaToRgb(const Byte *input, std::size_t numPixels, Byte *output) -> void;
+} // namespace qoi
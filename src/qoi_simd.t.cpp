@@ -0,0 +1,128 @@
+#include <qoi_cpu.h>
+#include <qoi_simd.h>
+#include <qoi_types.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+auto makeImage(std::size_t numPixels, Channel channels, const Pixel &pixel) -> std::vector<Byte> {
+    std::vector<Byte> bytes;
+    for (std::size_t iter = 0; iter < numPixels; ++iter) {
+        bytes.insert(bytes.end(), {pixel.d_red, pixel.d_green, pixel.d_blue});
+        if (channels == 4) {
+            bytes.emplace_back(pixel.d_alpha);
+        }
+    }
+
+    return bytes;
+}
+
+// Run 'test' once with the kernels bound to every level the CPU supports.
+template <class TEST>
+void forEachIsaLevel(TEST test) {
+    const IsaLevel active = activeIsaLevel();
+    for (int level = 0; level <= static_cast<int>(detectIsaLevel()); ++level) {
+        setIsaLevel(static_cast<IsaLevel>(level));
+        SCOPED_TRACE(isaLevelName(static_cast<IsaLevel>(level)));
+        test();
+    }
+
+    setIsaLevel(active);
+}
+} // namespace
+
+TEST(MatchRunLengthTest, stopsAtFirstDifferentPixel) {
+    forEachIsaLevel([] {
+        const Pixel pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 255};
+
+        for (Channel channels : {Channel{3}, Channel{4}}) {
+            for (std::size_t breakAt = 0; breakAt < 70; ++breakAt) {
+                auto bytes = makeImage(70, channels, pixel);
+                bytes[breakAt * channels + breakAt % 3] ^= 0x80;
+                const auto match = channels == 4 ? matchRunLength<4>(bytes.data(), 70, pixel)
+                                                  : matchRunLength<3>(bytes.data(), 70, pixel);
+                EXPECT_EQ(match, breakAt);
+            }
+        }
+    });
+}
+
+TEST(MatchRunLengthTest, matchesWholeBuffer) {
+    forEachIsaLevel([] {
+        const Pixel pixel{.d_red = 9, .d_green = 8, .d_blue = 7, .d_alpha = 6};
+
+        for (Channel channels : {Channel{3}, Channel{4}}) {
+            for (std::size_t numPixels = 0; numPixels < 40; ++numPixels) {
+                const auto bytes = makeImage(numPixels, channels, pixel);
+                const auto match = channels == 4
+                                       ? matchRunLength<4>(bytes.data(), numPixels, pixel)
+                                       : matchRunLength<3>(bytes.data(), numPixels, pixel);
+                EXPECT_EQ(match, numPixels);
+            }
+        }
+    });
+}
+
+TEST(MatchRunLengthTest, comparesAlphaOnlyForFourChannels) {
+    forEachIsaLevel([] {
+        const Pixel pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 255};
+        auto bytes = makeImage(20, 4, pixel);
+        bytes[10 * 4 + 3] = 0;
+
+        EXPECT_EQ(matchRunLength<4>(bytes.data(), 20, pixel), 10);
+    });
+}
+
+TEST(FillRunTest, writesExactlyTheRequestedPixels) {
+    forEachIsaLevel([] {
+        const Pixel pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 4};
+
+        for (Channel channels : {Channel{3}, Channel{4}}) {
+            for (std::size_t numPixels = 0; numPixels <= 62; ++numPixels) {
+                std::vector<Byte> output((numPixels + 1) * channels, 0xAA);
+                Byte *end = channels == 4 ? fillRun<4>(output.data(), numPixels, pixel)
+                                          : fillRun<3>(output.data(), numPixels, pixel);
+
+                ASSERT_EQ(end, output.data() + numPixels * channels);
+                const auto expected = makeImage(numPixels, channels, pixel);
+                EXPECT_TRUE(std::equal(expected.begin(), expected.end(), output.begin()));
+                EXPECT_TRUE(std::all_of(output.begin() + numPixels * channels, output.end(),
+                                        [](Byte byte) { return byte == 0xAA; }));
+            }
+        }
+    });
+}
+
+TEST(ChannelConversionTest, expandsAndCompactsExactlyTheRequestedPixels) {
+    forEachIsaLevel([] {
+        for (std::size_t numPixels = 0; numPixels <= 70; ++numPixels) {
+            std::vector<Byte> rgb(numPixels * 3);
+            for (std::size_t iter = 0; iter < rgb.size(); ++iter) {
+                rgb[iter] = static_cast<Byte>(iter * 7 + 1);
+            }
+
+            std::vector<Byte> rgba((numPixels + 1) * 4, 0xAA);
+            expandRgbToRgba(rgb.data(), numPixels, rgba.data());
+            for (std::size_t pixel = 0; pixel < numPixels; ++pixel) {
+                EXPECT_TRUE(std::equal(rgb.begin() + pixel * 3, rgb.begin() + pixel * 3 + 3,
+                                       rgba.begin() + pixel * 4));
+                EXPECT_EQ(rgba[pixel * 4 + 3], 255);
+            }
+
+            EXPECT_TRUE(std::all_of(rgba.end() - 4, rgba.end(),
+                                    [](Byte byte) { return byte == 0xAA; }));
+
+            std::vector<Byte> compacted((numPixels + 1) * 3, 0xAA);
+            compactRgbaToRgb(rgba.data(), numPixels, compacted.data());
+            EXPECT_TRUE(std::equal(rgb.begin(), rgb.end(), compacted.begin()));
+            EXPECT_TRUE(std::all_of(compacted.end() - 3, compacted.end(),
+                                    [](Byte byte) { return byte == 0xAA; }));
+        }
+    });
+}
@@ -0,0 +1,200 @@
+#include <qoi_streamdecoder.h>
+
+#include <qoi_optable.h>
+#include <qoi_simd.h>
+#include <qoi_utils.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace qoi {
+// CREATORS
+StreamDecoder::StreamDecoder(RowCallback onRow, Channel channels, std::span<Byte> rowBuffer)
+    : d_onRow(std::move(onRow)), d_channels(channels), d_ownRow(), d_row(rowBuffer), d_header(),
+      d_hasHeader(false), d_pending(), d_numPending(0),
+      d_prevPixel{.d_red = 0, .d_green = 0, .d_blue = 0, .d_alpha = 255}, d_pixelCache(),
+      d_rowPixel(0), d_rowIndex(0) {
+    if (channels != 0 && channels != 3 && channels != 4) {
+        throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
+    }
+}
+
+// PRIVATE MANIPULATORS
+void StreamDecoder::startImage() {
+    std::size_t offset = 0;
+    extractHeader(d_pending, d_header, offset);
+
+    if (!std::equal(d_header.d_magic.begin(), d_header.d_magic.end(), QOI_MAGIC_TAG.begin())) {
+        throw std::runtime_error("Unsupported File format. Expect QOI file.");
+    }
+
+    if (d_header.d_channels != 3 && d_header.d_channels != 4) {
+        throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
+    }
+
+    if (d_channels == 0) {
+        d_channels = d_header.d_channels;
+    }
+
+    const auto rowSize = static_cast<std::size_t>(d_header.d_width) * d_channels;
+    if (d_row.empty()) {
+        d_ownRow.resize(rowSize);
+        d_row = d_ownRow;
+    } else if (d_row.size() < rowSize) {
+        throw std::runtime_error("The row buffer is smaller than a row of the image");
+    }
+
+    // an image without pixels has no rows to hand out
+    if (d_header.d_width == 0) {
+        d_rowIndex = d_header.d_height;
+    }
+
+    d_hasHeader = true;
+}
+
+template <Channel CHANNELS>
+std::size_t StreamDecoder::decodeOps(std::span<const Byte> bytes) {
+    const Byte *data = bytes.data();
+    const std::size_t width = d_header.d_width;
+    Byte *row = d_row.data();
+
+    std::size_t offset = 0;
+    while (d_rowIndex < d_header.d_height && offset < bytes.size()) {
+        const auto &op = QOI_OP_TABLE[data[offset]];
+        if (offset + op.d_length > bytes.size()) {
+            break;
+        }
+
+        Pixel currPixel = d_prevPixel;
+        std::size_t count = 1;
+
+        switch (op.d_kind) {
+        case OpKind::RGBA:
+            currPixel = loadPixel(data + offset + 1);
+            break;
+        case OpKind::RGB:
+            // nothing follows the op in the chunk necessarily, so the bytes are read one by one
+            currPixel.d_red = data[offset + 1];
+            currPixel.d_green = data[offset + 2];
+            currPixel.d_blue = data[offset + 3];
+            break;
+        case OpKind::INDEX:
+            currPixel = d_pixelCache[op.d_value];
+            break;
+        case OpKind::DIFF:
+            currPixel.d_red += op.d_dr;
+            currPixel.d_green += op.d_dg;
+            currPixel.d_blue += op.d_db;
+            break;
+        case OpKind::LUMA: {
+            const Byte redBlue = data[offset + 1];
+            currPixel.d_red += op.d_dr + (redBlue >> 4);
+            currPixel.d_green += op.d_dg;
+            currPixel.d_blue += op.d_db + (redBlue & 0x0F);
+            break;
+        }
+        case OpKind::RUN:
+            count = op.d_value;
+            break;
+        }
+
+        offset += op.d_length;
+        d_pixelCache[hashIndex(currPixel)] = currPixel;
+        d_prevPixel = currPixel;
+
+        if (count == 1) {
+            std::memcpy(row + d_rowPixel * CHANNELS, &currPixel, CHANNELS);
+            if (++d_rowPixel == width) {
+                flushRow();
+            }
+
+            continue;
+        }
+
+        // a run may finish one row and carry on into the next ones
+        while (count > 0 && d_rowIndex < d_header.d_height) {
+            const auto numPixels = std::min(count, width - d_rowPixel);
+            fillRun<CHANNELS>(row + d_rowPixel * CHANNELS, numPixels, currPixel);
+            count -= numPixels;
+            d_rowPixel += numPixels;
+            if (d_rowPixel == width) {
+                flushRow();
+            }
+        }
+    }
+
+    return offset;
+}
+
+std::size_t StreamDecoder::decodeOps(std::span<const Byte> bytes) {
+    return d_channels == 4 ? decodeOps<4>(bytes) : decodeOps<3>(bytes);
+}
+
+void StreamDecoder::flushRow() {
+    d_onRow(d_row.first(static_cast<std::size_t>(d_header.d_width) * d_channels), d_rowIndex);
+    ++d_rowIndex;
+    d_rowPixel = 0;
+}
+
+// MANIPULATORS
+void StreamDecoder::push(std::span<const Byte> bytes) {
+    while (!bytes.empty()) {
+        if (!d_hasHeader) {
+            const auto take = std::min(bytes.size(), QOI_HEADER_SIZE - d_numPending);
+            std::copy_n(bytes.begin(), take, d_pending.begin() + d_numPending);
+            d_numPending += take;
+            bytes = bytes.subspan(take);
+
+            if (d_numPending == QOI_HEADER_SIZE) {
+                d_numPending = 0;
+                startImage();
+            }
+        } else if (isComplete()) {
+            // only the end marker is left, anything after it is ignored like the file decoder does
+            const auto take = std::min(bytes.size(), QOI_END_MARKER.size() - d_numPending);
+            std::copy_n(bytes.begin(), take, d_pending.begin() + d_numPending);
+            d_numPending += take;
+            return;
+        } else if (d_numPending > 0) {
+            // complete the op split between the previous chunk and this one
+            const std::size_t length = QOI_OP_TABLE[d_pending[0]].d_length;
+            const auto take = std::min(bytes.size(), length - d_numPending);
+            std::copy_n(bytes.begin(), take, d_pending.begin() + d_numPending);
+            d_numPending += take;
+            bytes = bytes.subspan(take);
+
+            if (d_numPending == length) {
+                d_numPending = 0;
+                decodeOps(std::span<const Byte>(d_pending).first(length));
+            }
+        } else {
+            bytes = bytes.subspan(decodeOps(bytes));
+
+            // whatever is left and not past the image is the start of an op cut in two
+            if (!isComplete()) {
+                std::copy(bytes.begin(), bytes.end(), d_pending.begin());
+                d_numPending = bytes.size();
+                return;
+            }
+        }
+    }
+}
+
+void StreamDecoder::finish() {
+    if (!isComplete() || d_numPending != QOI_END_MARKER.size() ||
+        !std::equal(QOI_END_MARKER.begin(), QOI_END_MARKER.end(), d_pending.begin())) {
+        throw std::runtime_error("QOI file is corrupted or incomplete");
+    }
+}
+
+// ACCESSORS
+bool StreamDecoder::hasHeader() const { return d_hasHeader; }
+
+const QOIHeader &StreamDecoder::header() const { return d_header; }
+
+Channel StreamDecoder::channels() const { return d_channels; }
+
+bool StreamDecoder::isComplete() const { return d_hasHeader && d_rowIndex == d_header.d_height; }
+} // namespace qoi
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <qoi_constants.h>
+#include <qoi_types.h>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace qoi {
+// Decodes a QOI file that arrives in chunks of any size, e.g. from a pipe or a socket. Bytes are
+// pushed as they come in, an op split between two chunks is kept until the rest of it arrives,
+// and every completed row of pixels is handed to a callback. Memory is bounded by a single row
+// no matter how large the image is.
+class StreamDecoder {
+  public:
+    // TYPES
+
+    // Called with the interleaved bytes of row 'y' once every pixel of it is decoded. The bytes
+    // stay valid only until the callback returns.
+    using RowCallback = std::function<void(std::span<const Byte> row, Height y)>;
+
+  private:
+    // DATA
+    RowCallback d_onRow;
+    Channel d_channels;
+    std::vector<Byte> d_ownRow;
+    std::span<Byte> d_row;
+    QOIHeader d_header;
+    bool d_hasHeader;
+    std::array<Byte, QOI_HEADER_SIZE> d_pending; // partial header, op or end marker
+    std::size_t d_numPending;
+    Pixel d_prevPixel;
+    alignas(64) PixelCache d_pixelCache;
+    std::size_t d_rowPixel;
+    Height d_rowIndex;
+
+    // PRIVATE MANIPULATORS
+    void startImage();
+
+    template <Channel CHANNELS>
+    std::size_t decodeOps(std::span<const Byte> bytes);
+
+    std::size_t decodeOps(std::span<const Byte> bytes);
+
+    void flushRow();
+
+  public:
+    // CREATORS
+
+    // Create a decoder handing rows of 'channels' (3 or 4) bytes per pixel to 'onRow', or of as
+    // many bytes as the file has channels when 'channels' is 0. Rows are decoded into 'rowBuffer'
+    // when it is given, which must then hold at least one row of the image, and into a buffer of
+    // the decoder otherwise.
+    explicit StreamDecoder(RowCallback onRow, Channel channels = 0,
+                           std::span<Byte> rowBuffer = {});
+
+    // MANIPULATORS
+
+    // Decode as much of the file as 'bytes' completes, calling the row callback for every row
+    // finished on the way. Throws if the header is invalid.
+    void push(std::span<const Byte> bytes);
+
+    // Check that the whole image and its end marker were pushed, and throw otherwise.
+    void finish();
+
+    // ACCESSORS
+
+    // Return whether the 14 byte header has arrived, after which 'header' is valid.
+    bool hasHeader() const;
+
+    const QOIHeader &header() const;
+
+    // Return the number of bytes per pixel of the rows handed out, once the header has arrived.
+    Channel channels() const;
+
+    // Return whether every row of the image has been handed out.
+    bool isComplete() const;
+};
+} // namespace qoi
@@ -0,0 +1,103 @@
+#include <qoi_constants.h>
+#include <qoi_decoder.h>
+#include <qoi_encoder.h>
+#include <qoi_streamdecoder.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using namespace qoi;
+
+namespace {
+auto makeEncodedImage(Width width, Height height, Channel channels) -> std::vector<Byte> {
+    // flat stretches that run across rows, interrupted by noise
+    std::mt19937 generator(5);
+    std::vector<Byte> bytes;
+    for (std::size_t iter = 0; iter < std::size_t{width} * height; ++iter) {
+        const bool flat = (iter / 45) % 2 == 0;
+        for (Channel channel = 0; channel < channels; ++channel) {
+            bytes.emplace_back(flat ? 200 : static_cast<Byte>(generator() % 8 + iter));
+        }
+    }
+
+    return Encoder().encodeToQOI(makeFileOutput(width, height, channels, 0, std::move(bytes)))
+        .d_bytes;
+}
+
+auto decodeInChunks(const std::vector<Byte> &encoded, std::size_t chunkSize, Channel channels)
+    -> std::vector<Byte> {
+    std::vector<Byte> image;
+    Height expectedRow = 0;
+    StreamDecoder decoder(
+        [&](std::span<const Byte> row, Height y) {
+            EXPECT_EQ(y, expectedRow++);
+            image.insert(image.end(), row.begin(), row.end());
+        },
+        channels);
+
+    const std::span<const Byte> bytes = encoded;
+    for (std::size_t offset = 0; offset < bytes.size(); offset += chunkSize) {
+        decoder.push(bytes.subspan(offset, std::min(chunkSize, bytes.size() - offset)));
+    }
+
+    decoder.finish();
+    return image;
+}
+} // namespace
+
+TEST(StreamDecoderTest, matchesFileDecoderForAnyChunkSize) {
+    for (Channel channels : {Channel{3}, Channel{4}}) {
+        const auto encoded = makeEncodedImage(37, 23, channels);
+        const auto stream =
+            makeFileOutput(37, 23, channels, 0,
+                           std::vector<Byte>(encoded.begin() + QOI_HEADER_SIZE, encoded.end()));
+
+        for (Channel outChannels : {Channel{3}, Channel{4}}) {
+            const auto expected = Decoder().decodeQOIToBytes(stream, outChannels);
+            for (std::size_t chunkSize : {1, 2, 3, 7, 64, 100000}) {
+                SCOPED_TRACE(chunkSize);
+                EXPECT_TRUE(std::ranges::equal(decodeInChunks(encoded, chunkSize, outChannels),
+                                               expected.d_bytes));
+            }
+        }
+    }
+}
+
+TEST(StreamDecoderTest, decodesIntoCallerRowBuffer) {
+    const auto encoded = makeEncodedImage(16, 4, 4);
+
+    std::vector<Byte> rowBuffer(16 * 4);
+    std::size_t numRows = 0;
+    StreamDecoder decoder(
+        [&](std::span<const Byte> row, Height) {
+            EXPECT_EQ(row.data(), rowBuffer.data());
+            ++numRows;
+        },
+        0, rowBuffer);
+    decoder.push(encoded);
+    decoder.finish();
+
+    EXPECT_EQ(numRows, 4);
+}
+
+TEST(StreamDecoderTest, rejectsIncompleteStream) {
+    const auto encoded = makeEncodedImage(16, 4, 3);
+
+    StreamDecoder missingPixels([](std::span<const Byte>, Height) {});
+    missingPixels.push(std::span<const Byte>(encoded).first(encoded.size() / 2));
+    EXPECT_FALSE(missingPixels.isComplete());
+    EXPECT_THROW(missingPixels.finish(), std::runtime_error);
+
+    StreamDecoder missingMarker([](std::span<const Byte>, Height) {});
+    missingMarker.push(std::span<const Byte>(encoded).first(encoded.size() - 1));
+    EXPECT_TRUE(missingMarker.isComplete());
+    EXPECT_THROW(missingMarker.finish(), std::runtime_error);
+}
@@ -0,0 +1,63 @@
+#include <qoi_streamencoder.h>
+
+#include <qoi_constants.h>
+#include <qoi_utils.h>
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+namespace qoi {
+// CREATORS
+StreamEncoder::StreamEncoder(Width width, Height height, Channel channels, ColorSpace colorspace,
+                             Sink sink)
+    : d_sink(std::move(sink)), d_encoder(), d_channels(channels),
+      d_remainingPixels(static_cast<std::size_t>(width) * static_cast<std::size_t>(height)),
+      d_encodedBuffer() {
+    if (channels != 3 && channels != 4) {
+        throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
+    }
+
+    std::array<Byte, QOI_HEADER_SIZE> header;
+    Byte *cursor = std::copy(QOI_MAGIC_TAG.cbegin(), QOI_MAGIC_TAG.cend(), header.data());
+    writeU32(width, cursor);
+    writeU32(height, cursor);
+    *cursor++ = channels;
+    *cursor = colorspace;
+
+    d_sink(header);
+}
+
+// MANIPULATORS
+void StreamEncoder::push(std::span<const Byte> bytes) {
+    const auto numPixels = bytes.size() / d_channels;
+    if (bytes.size() % d_channels != 0 || numPixels > d_remainingPixels) {
+        throw std::runtime_error("The data is corrupted or incomplete");
+    }
+
+    // worst case per pixel, plus room for the stray alpha byte of a trailing QOI_OP_RGB; the
+    // buffer keeps its capacity, so pushing rows of one size allocates only once
+    d_encodedBuffer.resize(numPixels * (d_channels + 1) + sizeof(Pixel));
+
+    Byte *cursor = d_channels == 4 ? d_encoder.encodePixels<4>(bytes, d_encodedBuffer.data())
+                                   : d_encoder.encodePixels<3>(bytes, d_encodedBuffer.data());
+    d_remainingPixels -= numPixels;
+
+    if (cursor != d_encodedBuffer.data()) {
+        d_sink(std::span<const Byte>(d_encodedBuffer.data(), cursor));
+    }
+}
+
+void StreamEncoder::finish() {
+    if (d_remainingPixels != 0) {
+        throw std::runtime_error("The data is corrupted or incomplete");
+    }
+
+    std::array<Byte, 1 + QOI_END_MARKER.size()> tail;
+    Byte *cursor = d_encoder.flushRun(tail.data());
+    cursor = std::copy(QOI_END_MARKER.cbegin(), QOI_END_MARKER.cend(), cursor);
+
+    d_sink(std::span<const Byte>(tail.data(), cursor));
+}
+} // namespace qoi
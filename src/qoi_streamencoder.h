@@ -0,0 +1,49 @@
+#pragma once
+
+#include <qoi_encoder.h>
+#include <qoi_types.h>
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace qoi {
+// Encodes an image that is produced progressively, e.g. row by row by a camera or a renderer.
+// Pixels are pushed as they become available and the encoded bytes are handed to a sink right
+// away, so only the pushed pixels, their encoding and the encoder state are ever resident. The
+// bytes passed to the sink are exactly those of 'Encoder::encodeToQOI' for the whole image.
+class StreamEncoder {
+  public:
+    // TYPES
+
+    // Called with each piece of the encoded file, in order. The bytes stay valid only until the
+    // callback returns.
+    using Sink = std::function<void(std::span<const Byte> bytes)>;
+
+  private:
+    // DATA
+    Sink d_sink;
+    Encoder d_encoder;
+    Channel d_channels;
+    std::size_t d_remainingPixels;
+    std::vector<Byte> d_encodedBuffer;
+
+  public:
+    // CREATORS
+
+    // Start encoding an image of the given dimensions with 'channels' (3 or 4) bytes per pixel
+    // and hand the 14 byte header to 'sink'.
+    StreamEncoder(Width width, Height height, Channel channels, ColorSpace colorspace, Sink sink);
+
+    // MANIPULATORS
+
+    // Encode the interleaved pixels in 'bytes', which follow the pixels pushed before in row-major
+    // order, and hand what they encode to the sink. A pending run is kept open across calls.
+    // Throws if 'bytes' holds a partial pixel or more pixels than the image has left.
+    void push(std::span<const Byte> bytes);
+
+    // Close the last run and write the end marker. Throws if the image is not complete.
+    void finish();
+};
+} // namespace qoi
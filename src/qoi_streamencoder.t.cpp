@@ -0,0 +1,58 @@
+#include <qoi_encoder.h>
+#include <qoi_streamencoder.h>
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+using namespace qoi;
+
+TEST(StreamEncoderTest, rowPushesMatchWholeImageEncode) {
+    for (Channel channels : {Channel{3}, Channel{4}}) {
+        // long flat stretches so that runs carry over from one row to the next
+        std::mt19937 generator(9);
+        std::vector<Byte> bytes;
+        for (std::size_t iter = 0; iter < 40 * 30; ++iter) {
+            const bool flat = (iter / 70) % 2 == 0;
+            for (Channel channel = 0; channel < channels; ++channel) {
+                bytes.emplace_back(flat ? 50 : static_cast<Byte>(generator() % 16));
+            }
+        }
+
+        const auto expected =
+            Encoder().encodeToQOI(makeFileOutput(40, 30, channels, 1, bytes)).d_bytes;
+
+        std::vector<Byte> encoded;
+        StreamEncoder encoder(40, 30, channels, 1, [&](std::span<const Byte> piece) {
+            encoded.insert(encoded.end(), piece.begin(), piece.end());
+        });
+
+        const std::span<const Byte> image = bytes;
+        const std::size_t rowSize = 40 * channels;
+        for (std::size_t offset = 0; offset < image.size(); offset += rowSize) {
+            encoder.push(image.subspan(offset, rowSize));
+        }
+
+        encoder.finish();
+        EXPECT_EQ(encoded, expected);
+    }
+}
+
+TEST(StreamEncoderTest, rejectsWrongPixelCounts) {
+    StreamEncoder encoder(2, 2, 3, 0, [](std::span<const Byte>) {});
+    const std::vector<Byte> row(2 * 3, 7);
+
+    EXPECT_THROW(encoder.push(std::span<const Byte>(row).first(4)), std::runtime_error);
+    encoder.push(row);
+    EXPECT_THROW(encoder.finish(), std::runtime_error);
+    encoder.push(row);
+    EXPECT_THROW(encoder.push(row), std::runtime_error);
+    EXPECT_NO_THROW(encoder.finish());
+}
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <array>
+#include <bit>
 #include <cstdint>
+#include <memory>
+#include <span>
 #include <vector>
 
 namespace qoi {
@@ -20,24 +23,32 @@ struct QOIHeader {
     ColorSpace d_colorspace;
 };
 
-struct Pixel {
+// A pixel is stored as its four channel bytes in memory order, so the whole pixel can be moved and
+// compared as one 32-bit word.
+struct alignas(4) Pixel {
     Byte d_red{0};
     Byte d_green{0};
     Byte d_blue{0};
     Byte d_alpha{0};
 
-    bool operator==(const Pixel &rhs) const {
-        return (d_red == rhs.d_red) && (d_green == rhs.d_green) && (d_blue == rhs.d_blue) &&
-               (d_alpha == rhs.d_alpha);
-    }
+    auto packed() const -> std::uint32_t { return std::bit_cast<std::uint32_t>(*this); }
+
+    bool operator==(const Pixel &rhs) const { return packed() == rhs.packed(); }
 };
 
+static_assert(sizeof(Pixel) == sizeof(std::uint32_t), "Pixel must pack into 32 bits");
+
+// The 64 entry index of previously seen pixels. It spans four cache lines; the codecs that hold
+// one align it to 64 bytes at the member declaration.
+using PixelCache = std::array<Pixel, 64>;
+
 struct FileOutput {
     Width d_width;
     Height d_height;
     Channel d_channels;
     ColorSpace d_colorspace;
-    std::vector<Byte> d_bytes;
+    std::span<const Byte> d_bytes;         // read-only view of the pixel or QOI op bytes
+    std::shared_ptr<const void> d_storage; // keeps the memory behind 'd_bytes' alive
 };
 
 struct EncodedOutput {
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <qoi_constants.h>
+#include <qoi_mappedfile.h>
+#include <qoi_simd.h>
 #include <qoi_types.h>
 
 #include <stb_image.h>
@@ -8,10 +10,14 @@
 
 #include <algorithm>
 #include <array>
+#include <bit>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <span>
 #include <stdexcept>
 #include <utility>
 #include <vector>
@@ -22,15 +28,47 @@ inline auto byte_ptr(char *p) -> Byte * { return reinterpret_cast<Byte *>(p); }
 inline auto char_ptr(Byte *p) -> char * { return reinterpret_cast<char *>(p); }
 
 inline auto hashIndex(const Pixel &pixel) -> Hash {
-    return ((pixel.d_red * 3) + (pixel.d_green * 5) + (pixel.d_blue * 7) + (pixel.d_alpha * 11)) %
-           64;
+    if constexpr (std::endian::native == std::endian::little) {
+        // spread red, blue, green and alpha into separate 16-bit lanes, then let one multiply
+        // accumulate 3r + 5g + 7b + 11a into the top byte
+        std::uint64_t lanes = pixel.packed();
+        lanes = (lanes | (lanes << 24)) & 0x00FF00FF00FF00FF;
+        return ((lanes * 0x0300070005000B00) >> 56) & 63;
+    } else {
+        return ((pixel.d_red * 3) + (pixel.d_green * 5) + (pixel.d_blue * 7) +
+                (pixel.d_alpha * 11)) %
+               64;
+    }
+}
+
+inline auto loadPixel(const Byte *bytes) -> Pixel {
+    Pixel pixel;
+    std::memcpy(&pixel, bytes, sizeof(Pixel));
+    return pixel;
+}
+
+inline auto storePixel(Byte *bytes, const Pixel &pixel) -> void {
+    std::memcpy(bytes, &pixel, sizeof(Pixel));
+}
+
+// Return a 'FileOutput' that owns 'bytes'.
+inline auto makeFileOutput(Width width, Height height, Channel channels, ColorSpace colorspace,
+                           std::vector<Byte> bytes) -> FileOutput {
+    auto storage = std::make_shared<const std::vector<Byte>>(std::move(bytes));
+    const std::span<const Byte> view{*storage};
+    return {.d_width = width,
+            .d_height = height,
+            .d_channels = channels,
+            .d_colorspace = colorspace,
+            .d_bytes = view,
+            .d_storage = std::move(storage)};
 }
 
 inline auto printByte(Byte byte) -> void {
     std::cout << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte) << ' ';
 }
 
-inline auto printBuffer(const std::vector<Byte> &buffer) -> void {
+inline auto printBuffer(std::span<const Byte> buffer) -> void {
     for (auto &byte : buffer) {
         printByte(byte);
     }
@@ -63,7 +101,7 @@ inline auto printPixel(const Pixel &pixel) -> void {
               << ", ALPHA: " << static_cast<uint32_t>(pixel.d_alpha) << std::endl;
 }
 
-inline auto readU32(const std::vector<Byte> &buffer, std::size_t &offset) -> std::uint32_t {
+inline auto readU32(std::span<const Byte> buffer, std::size_t &offset) -> std::uint32_t {
     uint32_t red = buffer[offset++] << 24;
     uint32_t blue = buffer[offset++] << 16;
     uint32_t green = buffer[offset++] << 8;
@@ -78,10 +116,42 @@ inline auto writeU32(std::uint32_t value, std::vector<Byte> &encodedBuffer) -> v
     encodedBuffer.emplace_back(value & 0xFF);
 }
 
+inline auto writeU32(std::uint32_t value, Byte *&cursor) -> void {
+    *cursor++ = (value >> 24) & 0xFF;
+    *cursor++ = (value >> 16) & 0xFF;
+    *cursor++ = (value >> 8) & 0xFF;
+    *cursor++ = value & 0xFF;
+}
+
+// Return the largest possible size of a QOI file for an image of the given dimensions: the
+// header, one tag byte plus every channel byte per pixel, and the end marker.
+inline auto maxEncodedSize(Width width, Height height, Channel channels) -> std::size_t {
+    return QOI_HEADER_SIZE +
+           static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * (channels + 1) +
+           QOI_END_MARKER.size();
+}
+
+// Replace 'pixels' with the interleaved pixels of 'CHANNELS' bytes in 'bytes', filling alpha with
+// 255 for 3 channels.
+template <Channel CHANNELS>
+inline auto convertBytesToPixel(const std::vector<Byte> &bytes, std::vector<Pixel> &pixels)
+    -> void {
+    const auto numPixels = bytes.size() / CHANNELS;
+    pixels.resize(numPixels);
+
+    // a Pixel is laid out exactly like one interleaved 4-channel pixel
+    auto *output = reinterpret_cast<Byte *>(pixels.data());
+    if constexpr (CHANNELS == 4) {
+        std::copy_n(bytes.data(), numPixels * 4, output);
+    } else {
+        expandRgbToRgba(bytes.data(), numPixels, output);
+    }
+}
+
 inline auto convertBytesToPixel(const std::vector<Byte> &bytes, std::vector<Pixel> &pixels,
                                 Channel channels) -> void {
     const auto pixelChannels = static_cast<std::size_t>(channels);
-    if (pixelChannels < 3) {
+    if (pixelChannels != 3 && pixelChannels != 4) {
         throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
     }
 
@@ -89,42 +159,42 @@ inline auto convertBytesToPixel(const std::vector<Byte> &bytes, std::vector<Pixe
         throw std::runtime_error("The data is corrupted or incomplete");
     }
 
-    const auto numPixels = bytes.size() / pixelChannels;
-    pixels.resize(numPixels);
+    if (pixelChannels == 4) {
+        convertBytesToPixel<4>(bytes, pixels);
+    } else {
+        convertBytesToPixel<3>(bytes, pixels);
+    }
+}
 
-    for (auto iter = 0; iter < numPixels; ++iter) {
-        const auto byteIndex = static_cast<std::size_t>(iter) * pixelChannels;
-        pixels[iter] = {.d_red = bytes[byteIndex],
-                        .d_green = bytes[byteIndex + 1],
-                        .d_blue = bytes[byteIndex + 2],
-                        .d_alpha = 255};
+// Replace 'bytes' with 'pixels' as interleaved pixels of 'CHANNELS' bytes, dropping alpha for 3
+// channels.
+template <Channel CHANNELS>
+inline auto convertPixelsToBytes(const std::vector<Pixel> &pixels, std::vector<Byte> &bytes)
+    -> void {
+    bytes.resize(pixels.size() * CHANNELS);
 
-        if (pixelChannels == 4) {
-            pixels[iter].d_alpha = bytes[byteIndex + 3];
-        }
+    const auto *input = reinterpret_cast<const Byte *>(pixels.data());
+    if constexpr (CHANNELS == 4) {
+        std::copy_n(input, bytes.size(), bytes.data());
+    } else {
+        compactRgbaToRgb(input, pixels.size(), bytes.data());
     }
 }
 
 inline auto convertPixelsToBytes(const std::vector<Pixel> &pixels, std::vector<Byte> &bytes,
                                  Channel channels) -> void {
-    if (channels < 3) {
+    if (channels != 3 && channels != 4) {
         throw std::runtime_error("unsupported channel size, support only 3 or 4 channels!");
     }
 
-    bytes.reserve(pixels.size() * channels);
-
-    for (auto &pixel : pixels) {
-        bytes.emplace_back(pixel.d_red);
-        bytes.emplace_back(pixel.d_green);
-        bytes.emplace_back(pixel.d_blue);
-
-        if (channels == 4) {
-            bytes.emplace_back(pixel.d_alpha);
-        }
+    if (channels == 4) {
+        convertPixelsToBytes<4>(pixels, bytes);
+    } else {
+        convertPixelsToBytes<3>(pixels, bytes);
     }
 }
 
-inline auto extractHeader(const std::vector<Byte> &buffer, QOIHeader &header, std::size_t &offset)
+inline auto extractHeader(std::span<const Byte> buffer, QOIHeader &header, std::size_t &offset)
     -> void {
     // extract the magic number
     std::copy(buffer.begin(), buffer.begin() + 4, header.d_magic.begin());
@@ -143,7 +213,7 @@ inline auto extractHeader(const std::vector<Byte> &buffer, QOIHeader &header, st
     header.d_colorspace = buffer[offset++];
 }
 
-inline auto hasValidEndMarker(const std::vector<Byte> &buffer) -> bool {
+inline auto hasValidEndMarker(std::span<const Byte> buffer) -> bool {
     if (buffer.size() < 8) {
         return false;
     }
@@ -158,19 +228,36 @@ inline auto hasValidEndMarker(const std::vector<Byte> &buffer) -> bool {
     return true;
 }
 
-constexpr FileOutput readQOIFile(const std::filesystem::path &filename) {
-    std::ifstream file{filename, std::ios::binary};
+// Read and validate only the 14 byte header of the QOI file 'filename'.
+inline auto readQOIHeader(const std::filesystem::path &filename) -> QOIHeader {
+    // unbuffered, so only the header bytes are read from disk
+    std::ifstream file;
+    file.rdbuf()->pubsetbuf(nullptr, 0);
+    file.open(filename, std::ios::binary);
     if (!file.is_open()) {
         throw std::runtime_error("Failed to open file: " + filename.string());
     }
 
-    std::vector<Byte> buffer((std::istreambuf_iterator<char>(file)),
-                             std::istreambuf_iterator<char>());
+    std::array<Byte, QOI_HEADER_SIZE> buffer;
+    if (!file.read(char_ptr(buffer.data()), buffer.size())) {
+        throw std::runtime_error("QOI file header is missing!");
+    }
 
-    if (buffer.size() > MAX_FILE_SIZE) {
-        throw std::runtime_error(filename.string() + " exceeds the limit of 1GB");
+    std::size_t offset = 0;
+    QOIHeader header{};
+    extractHeader(buffer, header, offset);
+
+    if (!std::equal(header.d_magic.begin(), header.d_magic.end(), QOI_MAGIC_TAG.begin())) {
+        throw std::runtime_error("Unsupported File format. Expect QOI file.");
     }
 
+    return header;
+}
+
+// Return a view of the ops after the header of the QOI file held by 'buffer', which 'storage'
+// keeps alive. Throws if 'buffer' is not a complete QOI file.
+inline auto parseQOIFile(std::span<const Byte> buffer, std::shared_ptr<const void> storage)
+    -> FileOutput {
     if (buffer.size() < QOI_HEADER_SIZE) {
         throw std::runtime_error("QOI file header is missing!");
     }
@@ -191,15 +278,27 @@ constexpr FileOutput readQOIFile(const std::filesystem::path &filename) {
             .d_height = header.d_height,
             .d_channels = header.d_channels,
             .d_colorspace = header.d_colorspace,
-            .d_bytes = std::vector<Byte>(buffer.begin() + offset, buffer.end())};
+            .d_bytes = buffer.subspan(offset),
+            .d_storage = std::move(storage)};
 }
 
-constexpr FileOutput readPPMFile(const std::filesystem::path &filename) {
-    std::ifstream file{filename, std::ios::binary};
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open file: " + filename.string());
+// Map the QOI file 'filename' and return a view of the ops after the header. With 'preload', the
+// file is read from disk before returning instead of while it is decoded.
+inline FileOutput readQOIFile(const std::filesystem::path &filename, bool preload = false) {
+    // map the file and hand out a view of the ops after the header, nothing is copied
+    auto file = std::make_shared<const MappedFile>(filename, preload);
+    const auto buffer = file->bytes();
+
+    if (buffer.size() > MAX_FILE_SIZE) {
+        throw std::runtime_error(filename.string() + " exceeds the limit of 1GB");
     }
 
+    return parseQOIFile(buffer, std::move(file));
+}
+
+// Read the header of the P6 PPM file open in 'file' into 'width' and 'height', leaving 'file' at
+// the first pixel byte. Throws if the file is not an 8-bit P6 PPM.
+inline auto readPPMHeader(std::istream &file, Width &width, Height &height) -> void {
     std::string tag;
     file >> tag;
     if (tag != PPM_MAGIC_TAG) {
@@ -224,7 +323,7 @@ constexpr FileOutput readPPMFile(const std::filesystem::path &filename) {
         }
     }
 
-    std::uint32_t width, height, maxPixelValue;
+    std::uint32_t maxPixelValue;
     file >> width >> height >> maxPixelValue;
 
     if (maxPixelValue != PPM_MAX_PIXEL_VALUE) {
@@ -232,6 +331,17 @@ constexpr FileOutput readPPMFile(const std::filesystem::path &filename) {
     }
 
     file.ignore();
+}
+
+inline FileOutput readPPMFile(const std::filesystem::path &filename) {
+    std::ifstream file{filename, std::ios::binary};
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open file: " + filename.string());
+    }
+
+    Width width;
+    Height height;
+    readPPMHeader(file, width, height);
 
     std::vector<Byte> bytes(width * height * 3);
 
@@ -240,11 +350,7 @@ constexpr FileOutput readPPMFile(const std::filesystem::path &filename) {
         throw std::runtime_error("Unable to read pixel data from PPM file");
     }
 
-    return {.d_width = width,
-            .d_height = height,
-            .d_channels = 3,
-            .d_colorspace = 0,
-            .d_bytes = std::move(bytes)};
+    return makeFileOutput(width, height, 3, 0, std::move(bytes));
 }
 
 inline FileOutput readPNGFile(const std::filesystem::path &filename) {
@@ -264,14 +370,8 @@ inline FileOutput readPNGFile(const std::filesystem::path &filename) {
 
     stbi_image_free(data);
 
-    std::cout << "width=" << width << ", height=" << height << ", channels=" << channels
-              << std::endl;
-
-    return {.d_width = static_cast<Width>(width),
-            .d_height = static_cast<Height>(height),
-            .d_channels = static_cast<Channel>(channels),
-            .d_colorspace = 0,
-            .d_bytes = std::move(bytes)};
+    return makeFileOutput(static_cast<Width>(width), static_cast<Height>(height),
+                          static_cast<Channel>(channels), 0, std::move(bytes));
 }
 
 inline auto writeToPPMFile(const std::filesystem::path &filename, const DecodedOutput &decodedData)
@@ -286,6 +386,16 @@ inline auto writeToPPMFile(const std::filesystem::path &filename, const DecodedO
     }
 }
 
+inline auto writeToPPMFile(const std::filesystem::path &filename, const FileOutput &image) -> void {
+    if (image.d_channels != 3) {
+        throw std::runtime_error("PPM output expects 3 channel pixel data");
+    }
+
+    std::ofstream out(filename, std::ios::binary);
+    out << "P6\n" << image.d_width << " " << image.d_height << "\n255\n";
+    out.write(reinterpret_cast<const char *>(image.d_bytes.data()), image.d_bytes.size());
+}
+
 inline auto writeToQOIFile(const std::filesystem::path &filename, const EncodedOutput &encodedData)
     -> void {
     std::ofstream out(filename, std::ios::binary);
@@ -303,4 +413,9 @@ inline auto writeToPNGFile(const std::filesystem::path &filename,
                    decodedOutput.d_width * decodedOutput.d_channels);
 }
 
+inline auto writeToPNGFile(const std::filesystem::path &filename, const FileOutput &image) -> void {
+    stbi_write_png(filename.c_str(), image.d_width, image.d_height, image.d_channels,
+                   image.d_bytes.data(), image.d_width * image.d_channels);
+}
+
 } // namespace qoi
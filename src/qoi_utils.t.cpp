@@ -0,0 +1,40 @@
+#include <qoi_types.h>
+#include <qoi_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <random>
+
+using namespace qoi;
+
+TEST(HashIndexTest, matchesSpecificationFormula) {
+    std::mt19937 generator(7);
+    for (int iter = 0; iter < 100000; ++iter) {
+        const auto value = generator();
+        const Pixel pixel{.d_red = static_cast<Byte>(value),
+                          .d_green = static_cast<Byte>(value >> 8),
+                          .d_blue = static_cast<Byte>(value >> 16),
+                          .d_alpha = static_cast<Byte>(value >> 24)};
+        const Hash expected =
+            (pixel.d_red * 3 + pixel.d_green * 5 + pixel.d_blue * 7 + pixel.d_alpha * 11) % 64;
+        ASSERT_EQ(hashIndex(pixel), expected);
+    }
+}
+
+TEST(PixelTest, loadsAndStoresChannelsInMemoryOrder) {
+    const std::array<Byte, 5> bytes = {0xFF, 1, 2, 3, 4};
+    const auto pixel = loadPixel(bytes.data() + 1);
+    EXPECT_EQ(pixel, (Pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 4}));
+
+    std::array<Byte, 5> stored{};
+    storePixel(stored.data() + 1, pixel);
+    EXPECT_EQ(stored, (std::array<Byte, 5>{0, 1, 2, 3, 4}));
+}
+
+TEST(PixelTest, equalityComparesEveryChannel) {
+    const Pixel pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 4};
+    EXPECT_FALSE(pixel == (Pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 5}));
+    EXPECT_FALSE(pixel == (Pixel{.d_red = 0, .d_green = 2, .d_blue = 3, .d_alpha = 4}));
+    EXPECT_TRUE(pixel == (Pixel{.d_red = 1, .d_green = 2, .d_blue = 3, .d_alpha = 4}));
+}